@@ -472,6 +472,11 @@ GenioApp::_PrepareConfig(ConfigManager& cfg)
 	// TODO: Not sure about translating "LSP"
 	cfg.AddConfig("LSP", "lsp_clangd_log_level", B_TRANSLATE("Log level:"),
 		(int32)lsp_log_level::LSP_LOG_LEVEL_ERROR, &lsplevels);
+	cfg.AddConfig("LSP", "lsp_shared_server",
+		B_TRANSLATE("Use one language server for all projects"), false);
+	GMessage openDocuments = { {"min", 1}, {"max", 100} };
+	cfg.AddConfig("LSP", "lsp_max_open_documents",
+		B_TRANSLATE("Files kept open on the language server:"), 10, &openDocuments);
 
 	BString sourceControl(B_TRANSLATE("Source control"));
 	cfg.AddConfig(sourceControl.String(), "repository_outline",
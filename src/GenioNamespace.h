@@ -16,6 +16,8 @@ namespace GenioNames
 	const BString kSettingsFilesToReopen("files_to_reopen.settings");
 	const BString kSettingsProjectsToReopen("workspace.settings");
 	const BString kProjectSettingsFile(".genio");
+	const BString kProjectIndexDirectory("project_index");
+	const BString kSaveTempSuffix(".genio-save");
 }
 
 #endif // Genio_NAMESPACE_H
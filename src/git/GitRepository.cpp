@@ -14,6 +14,7 @@
 #include <Path.h>
 
 #include "GitCredentialsWindow.h"
+#include "GitStatus.h"
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "GitRepository"
@@ -321,26 +322,11 @@ namespace Genio::Git {
 			if (s->status == GIT_STATUS_CURRENT)
 				continue;
 
-			BString filePath = s->index_to_workdir->old_file.path;
-			BString fileStatus;
-
-			if (s->status & GIT_STATUS_WT_NEW)
-				fileStatus = B_TRANSLATE("New file");
-
-			else if (s->status & GIT_STATUS_INDEX_NEW)
-				fileStatus = B_TRANSLATE("New file staged");
-
-			else if (s->status & GIT_STATUS_WT_MODIFIED)
-				fileStatus = B_TRANSLATE("File modified");
-
-			else if (s->status & GIT_STATUS_INDEX_MODIFIED)
-				fileStatus = B_TRANSLATE("File modified on index");
-
-			else if (s->status & GIT_STATUS_WT_DELETED)
-				fileStatus = B_TRANSLATE("File deleted");
-//
-			else if (s->status & GIT_STATUS_INDEX_DELETED)
-				fileStatus = B_TRANSLATE("File deleted from index");
+			// only staged changes have no index to workdir delta
+			const git_diff_delta* delta = s->index_to_workdir != nullptr
+				? s->index_to_workdir : s->head_to_index;
+			BString filePath = delta->old_file.path;
+			BString fileStatus = GitStatus::StatusText(s->status);
 
 			fileStatuses.emplace_back(filePath, fileStatus);
 		}
@@ -0,0 +1,344 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+
+#include "GitStatus.h"
+
+#include <Autolock.h>
+#include <Catalog.h>
+#include <Message.h>
+#include <NodeMonitor.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Log.h"
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "GitStatus"
+
+// changes received in this time are read together
+static const bigtime_t kSettleDelay = 250000;
+// a steady stream of changes doesn't postpone the refresh longer than this
+static const bigtime_t kMaxSettleDelay = 2000000;
+// with more changed paths the whole work tree is read
+static const size_t kMaxScopes = 64;
+
+
+static inline bool
+IsUnder(const std::string& path, const std::string& scope)
+{
+	if (scope.empty())
+		return true;
+	return path.compare(0, scope.length(), scope) == 0
+		&& (path.length() == scope.length() || path[scope.length()] == '/');
+}
+
+
+namespace Genio::Git {
+
+	GitStatus::GitStatus(const BString& path, const BMessenger& target)
+		:
+		fPath(path.String()),
+		fTarget(target),
+		fLock("GitStatus"),
+		fFullRefresh(true),
+		fSem(create_sem(0, "GitStatus changes")),
+		fThread(-1),
+		fStopRequested(false),
+		fReady(false)
+	{
+		git_libgit2_init();
+	}
+
+
+	GitStatus::~GitStatus()
+	{
+		Stop();
+		delete_sem(fSem);
+		git_libgit2_shutdown();
+	}
+
+
+	status_t
+	GitStatus::Start()
+	{
+		if (fThread >= 0)
+			return B_OK;
+
+		fThread = spawn_thread(_RunThread, "GitStatus", B_LOW_PRIORITY, this);
+		if (fThread < 0)
+			return fThread;
+
+		release_sem(fSem);
+		return resume_thread(fThread);
+	}
+
+
+	void
+	GitStatus::Stop()
+	{
+		if (fThread < 0)
+			return;
+
+		fStopRequested = true;
+		release_sem(fSem);
+
+		status_t exitValue;
+		wait_for_thread(fThread, &exitValue);
+		fThread = -1;
+	}
+
+
+	void
+	GitStatus::EntryChanged(BMessage* message)
+	{
+		int32 opCode;
+		if (message->FindInt32("opcode", &opCode) != B_OK)
+			return;
+
+		const char* path;
+		switch (opCode) {
+			case B_ENTRY_CREATED:
+			case B_ENTRY_REMOVED:
+			case B_ENTRY_MOVED:
+			case B_STAT_CHANGED:
+				if (message->FindString("path", &path) == B_OK)
+					_AddDirty(path);
+				if (message->FindString("from path", &path) == B_OK)
+					_AddDirty(path);
+				break;
+			default:
+				return;
+		}
+		release_sem_etc(fSem, 1, B_DO_NOT_RESCHEDULE);
+	}
+
+
+	void
+	GitStatus::Refresh()
+	{
+		{
+			BAutolock lock(fLock);
+			fFullRefresh = true;
+		}
+		release_sem(fSem);
+	}
+
+
+	void
+	GitStatus::GetStatus(StatusMap& status) const
+	{
+		BAutolock lock(fLock);
+		status = fStatus;
+	}
+
+
+	/* static */
+	BString
+	GitStatus::StatusText(uint32 status)
+	{
+		if (status & GIT_STATUS_WT_NEW)
+			return B_TRANSLATE("New file");
+		if (status & GIT_STATUS_INDEX_NEW)
+			return B_TRANSLATE("New file staged");
+		if (status & GIT_STATUS_WT_MODIFIED)
+			return B_TRANSLATE("File modified");
+		if (status & GIT_STATUS_INDEX_MODIFIED)
+			return B_TRANSLATE("File modified on index");
+		if (status & GIT_STATUS_WT_DELETED)
+			return B_TRANSLATE("File deleted");
+		if (status & GIT_STATUS_INDEX_DELETED)
+			return B_TRANSLATE("File deleted from index");
+		return BString();
+	}
+
+
+	/* static */
+	status_t
+	GitStatus::_RunThread(void* cookie)
+	{
+		static_cast<GitStatus*>(cookie)->_Run();
+		return B_OK;
+	}
+
+
+	void
+	GitStatus::_Run()
+	{
+		git_repository* repository = nullptr;
+		if (git_repository_open(&repository, fPath.c_str()) != 0) {
+			const git_error* error = git_error_last();
+			LogError("GitStatus: can't open repository %s: %s", fPath.c_str(),
+				error != nullptr ? error->message : "");
+			return;
+		}
+
+		{
+			BAutolock lock(fLock);
+			const char* workdir = git_repository_workdir(repository);
+			fWorkdir = workdir != nullptr ? workdir : "";
+			fGitdir = git_repository_path(repository);
+		}
+
+		bool cold = true;
+		while (!fStopRequested) {
+			if (acquire_sem(fSem) != B_OK)
+				break;
+			// let a burst of changes (a checkout, a build) settle
+			const bigtime_t deadline = system_time() + kMaxSettleDelay;
+			while (!fStopRequested && system_time() < deadline
+				&& acquire_sem_etc(fSem, 1, B_RELATIVE_TIMEOUT,
+					std::min(kSettleDelay, deadline - system_time())) == B_OK) {
+			}
+			if (fStopRequested)
+				break;
+
+			bool full;
+			std::set<std::string> dirty;
+			{
+				BAutolock lock(fLock);
+				full = fFullRefresh;
+				fFullRefresh = false;
+				dirty.swap(fDirty);
+			}
+
+			// the paths inside a folder read anyway are skipped
+			std::vector<std::string> scopes;
+			for (const std::string& path : dirty) {
+				if (scopes.empty() || !IsUnder(path, scopes.back()))
+					scopes.push_back(path);
+			}
+			if (scopes.size() > kMaxScopes)
+				full = true;
+			if (full) {
+				scopes.clear();
+				scopes.push_back("");
+			}
+
+			const bigtime_t start = system_time();
+			BMessage delta(MSG_GIT_STATUS_CHANGED);
+			delta.AddString("project", fPath.c_str());
+			int32 entries = 0;
+			for (const std::string& scope : scopes) {
+				StatusMap status;
+				if (_ReadStatus(repository, scope, status) != B_OK)
+					continue;
+				entries += status.size();
+				_Update(scope, status, delta);
+			}
+
+			if (full) {
+				LogInfo("GitStatus: %s %s refresh, %d entries in %" B_PRId64 " ms",
+					fPath.c_str(), cold ? "cold" : "warm", entries,
+					(system_time() - start) / 1000);
+				cold = false;
+			} else {
+				LogInfo("GitStatus: %s %d paths refreshed, %d entries in %" B_PRId64 " us",
+					fPath.c_str(), (int32)scopes.size(), entries, system_time() - start);
+			}
+
+			const bool first = !fReady;
+			fReady = true;
+			if (first || delta.HasString("path") || delta.HasString("removed"))
+				fTarget.SendMessage(&delta);
+		}
+
+		git_repository_free(repository);
+	}
+
+
+	status_t
+	GitStatus::_ReadStatus(git_repository* repository, const std::string& scope,
+		StatusMap& status) const
+	{
+		git_status_options options;
+		git_status_init_options(&options, GIT_STATUS_OPTIONS_VERSION);
+		options.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+		// the scope is a path, not a pattern: "pages/[id].tsx" is matched literally
+		options.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_RENAMES_HEAD_TO_INDEX
+			| GIT_STATUS_OPT_SORT_CASE_SENSITIVELY | GIT_STATUS_OPT_DISABLE_PATHSPEC_MATCH;
+
+		char* pathspec = const_cast<char*>(scope.c_str());
+		if (!scope.empty()) {
+			options.pathspec.strings = &pathspec;
+			options.pathspec.count = 1;
+		}
+
+		git_status_list* list = nullptr;
+		if (git_status_list_new(&list, repository, &options) != 0) {
+			const git_error* error = git_error_last();
+			LogError("GitStatus: can't read the status of %s [%s]: %s", fPath.c_str(),
+				scope.c_str(), error != nullptr ? error->message : "");
+			return B_ERROR;
+		}
+
+		const size_t count = git_status_list_entrycount(list);
+		for (size_t i = 0; i < count; i++) {
+			const git_status_entry* entry = git_status_byindex(list, i);
+			if (entry->status == GIT_STATUS_CURRENT)
+				continue;
+
+			const git_diff_delta* diff = entry->index_to_workdir != nullptr
+				? entry->index_to_workdir : entry->head_to_index;
+			if (diff == nullptr || diff->old_file.path == nullptr)
+				continue;
+			std::string path(diff->old_file.path);
+			if (IsUnder(path, scope) || IsUnder(scope, path))
+				status[path] = entry->status;
+		}
+		git_status_list_free(list);
+		return B_OK;
+	}
+
+
+	void
+	GitStatus::_Update(const std::string& scope, const StatusMap& status, BMessage& delta)
+	{
+		BAutolock lock(fLock);
+
+		// the entries no longer reported
+		auto entry = fStatus.lower_bound(scope);
+		while (entry != fStatus.end()
+			&& entry->first.compare(0, scope.length(), scope) == 0) {
+			if (IsUnder(entry->first, scope)
+				&& status.find(entry->first) == status.end()) {
+				delta.AddString("removed", entry->first.c_str());
+				entry = fStatus.erase(entry);
+			} else
+				entry++;
+		}
+
+		for (auto& file : status) {
+			auto found = fStatus.find(file.first);
+			if (found != fStatus.end() && found->second == file.second)
+				continue;
+			fStatus[file.first] = file.second;
+			delta.AddString("path", file.first.c_str());
+			delta.AddInt32("status", (int32)file.second);
+		}
+	}
+
+
+	void
+	GitStatus::_AddDirty(const char* path)
+	{
+		std::string changed(path);
+
+		BAutolock lock(fLock);
+		if (fWorkdir.empty())
+			return;
+
+		// the index, HEAD or a branch changed: anything can be different
+		if (changed.compare(0, fGitdir.length(), fGitdir) == 0
+			|| changed + "/" == fGitdir) {
+			fFullRefresh = true;
+			return;
+		}
+		if (changed.compare(0, fWorkdir.length(), fWorkdir) != 0)
+			return;
+		fDirty.insert(changed.substr(fWorkdir.length()));
+	}
+}
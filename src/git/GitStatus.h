@@ -0,0 +1,81 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#pragma once
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <String.h>
+
+#include <git2.h>
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+
+class BMessage;
+
+enum {
+	MSG_GIT_STATUS_CHANGED = 'gsch'
+};
+
+// Status of the files of a git repository, read by a background thread.
+// The first refresh reads the whole work tree, then only the paths reported
+// by the path monitor of the ProjectBrowser are read again. Changes inside
+// the .git folder (index, HEAD, refs...) and Refresh() read everything again.
+// After each refresh the target receives a MSG_GIT_STATUS_CHANGED message
+// with the differences: "project" (string), "path" and "status" (string,
+// int32) for each file added or changed, "removed" (string) for each file
+// no longer reported. The paths are relative to the work tree.
+
+namespace Genio::Git {
+
+	class GitStatus {
+	public:
+		typedef std::map<std::string, uint32> StatusMap;
+
+							GitStatus(const BString& path, const BMessenger& target);
+							~GitStatus();
+
+		status_t			Start();
+		void				Stop();
+
+		// B_PATH_MONITOR notifications of the project folder
+		void				EntryChanged(BMessage* message);
+		// reads again the status of the whole work tree
+		void				Refresh();
+
+		// the last known status, empty until the first refresh is over
+		void				GetStatus(StatusMap& status) const;
+		bool				IsReady() const { return fReady; }
+
+		static BString		StatusText(uint32 status);
+
+	private:
+		static status_t		_RunThread(void* cookie);
+		void				_Run();
+		status_t			_ReadStatus(git_repository* repository, const std::string& scope,
+								StatusMap& status) const;
+		void				_Update(const std::string& scope, const StatusMap& status,
+								BMessage& delta);
+		void				_AddDirty(const char* path);
+
+		std::string			fPath;
+		BMessenger			fTarget;
+
+		mutable BLocker		fLock;
+		StatusMap			fStatus;
+		std::string			fWorkdir;
+		std::string			fGitdir;
+		std::set<std::string>	fDirty;
+		bool				fFullRefresh;
+		sem_id				fSem;
+
+		thread_id			fThread;
+		std::atomic<bool>	fStopRequested;
+		std::atomic<bool>	fReady;
+	};
+}
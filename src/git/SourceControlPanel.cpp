@@ -13,6 +13,7 @@
 #include <CheckBox.h>
 #include <Clipboard.h>
 #include <LayoutBuilder.h>
+#include <ListView.h>
 #include <ObjectList.h>
 #include <OutlineListView.h>
 #include <PathMonitor.h>
@@ -22,11 +23,14 @@
 #include <ScrollView.h>
 #include <StringView.h>
 
+#include <iterator>
+
 #include "ConfigManager.h"
 #include "GenioApp.h"
 #include "GenioWindow.h"
 #include "GenioWindowMessages.h"
 #include "GitAlert.h"
+#include "GitStatus.h"
 #include "GTextAlert.h"
 #include "Log.h"
 #include "ProjectBrowser.h"
@@ -53,12 +57,15 @@ enum MainIndex {
 };
 
 const int kBurstTimeout = 1000000;
+// with more changes the list of the changed files is filled again
+const int32 kMaxIncrementalChanges = 100;
 
 SourceControlPanel::SourceControlPanel()
 	:
 	BView(B_TRANSLATE("Source control"), B_WILL_DRAW | B_FRAME_EVENTS ),
 	fProjectMenu(nullptr),
 	fBranchMenu(nullptr),
+	fChangesList(nullptr),
 	fProjectList(nullptr),
 	fSelectedProjectPath(),
 	fCurrentBranch(nullptr),
@@ -117,6 +124,8 @@ SourceControlPanel::SourceControlPanel()
 
 SourceControlPanel::~SourceControlPanel()
 {
+	for (auto& file : fChangedFiles)
+		delete file.second;
 	delete fLogView;
 	delete fChangesView;
 	delete fRepositoryView;
@@ -152,14 +161,91 @@ SourceControlPanel::_InitRepositoryView()
 void
 SourceControlPanel::_InitChangesView()
 {
-	fChangesView = BLayoutBuilder::Group<>(B_HORIZONTAL, B_USE_BORDER_INSETS)
-		.AddGroup(B_VERTICAL)
-			.AddGlue()
-			.Add(new BButton("changes"))
-			.AddGlue()
-		.End()
-		.AddGlue()
-		.View();
+	fChangesList = new BListView("Changes list");
+	fChangesView = new BScrollView("Changes scroll view",
+		fChangesList, B_FRAME_EVENTS | B_WILL_DRAW, true, true, border_style::B_NO_BORDER);
+}
+
+
+void
+SourceControlPanel::_EmptyChangesView()
+{
+	fChangesList->MakeEmpty();
+	for (auto& file : fChangedFiles)
+		delete file.second;
+	fChangedFiles.clear();
+}
+
+
+static BString
+ChangeLabel(const char* path, uint32 status)
+{
+	BString label(path);
+	label << "  (" << GitStatus::StatusText(status) << ")";
+	return label;
+}
+
+
+void
+SourceControlPanel::_UpdateChangesView()
+{
+	_EmptyChangesView();
+
+	ProjectFolder* project = _GetSelectedProject();
+	if (project == nullptr || project->GetGitStatus() == nullptr)
+		return;
+
+	// read by GitStatus in background, it may not be complete yet
+	GitStatus::StatusMap status;
+	project->GetGitStatus()->GetStatus(status);
+	for (auto& file : status) {
+		BStringItem* item = new BStringItem(ChangeLabel(file.first.c_str(), file.second));
+		fChangedFiles[file.first] = item;
+		fChangesList->AddItem(item);
+	}
+}
+
+
+void
+SourceControlPanel::_ApplyStatusChanges(BMessage* message)
+{
+	type_code type;
+	int32 changed = 0;
+	int32 removed = 0;
+	message->GetInfo("path", &type, &changed);
+	message->GetInfo("removed", &type, &removed);
+
+	// faster to read them all
+	if (fChangedFiles.empty() || changed + removed > kMaxIncrementalChanges) {
+		_UpdateChangesView();
+		return;
+	}
+
+	const char* path;
+	for (int32 i = 0; message->FindString("removed", i, &path) == B_OK; i++) {
+		auto found = fChangedFiles.find(path);
+		if (found == fChangedFiles.end())
+			continue;
+		fChangesList->RemoveItem(found->second);
+		delete found->second;
+		fChangedFiles.erase(found);
+	}
+
+	int32 status;
+	for (int32 i = 0; message->FindString("path", i, &path) == B_OK
+			&& message->FindInt32("status", i, &status) == B_OK; i++) {
+		const BString label = ChangeLabel(path, status);
+		auto found = fChangedFiles.find(path);
+		if (found != fChangedFiles.end()) {
+			found->second->SetText(label);
+			fChangesList->InvalidateItem(fChangesList->IndexOf(found->second));
+			continue;
+		}
+		// sorted by path, as the map
+		auto inserted = fChangedFiles.emplace(path, new BStringItem(label)).first;
+		fChangesList->AddItem(inserted->second,
+			std::distance(fChangedFiles.begin(), inserted));
+	}
 }
 
 
@@ -213,6 +299,7 @@ SourceControlPanel::AttachedToWindow()
 	if (Window()->LockLooper()) {
 		Window()->StartWatching(this, MSG_NOTIFY_PROJECT_LIST_CHANGED);
 		Window()->StartWatching(this, MSG_NOTIFY_PROJECT_SET_ACTIVE);
+		Window()->StartWatching(this, MSG_NOTIFY_GIT_STATUS_CHANGED);
 		auto gwin = static_cast<GenioWindow *>(Window());
 		if (gwin != nullptr) {
 			auto projectBrowser = gwin->GetProjectBrowser();
@@ -241,6 +328,7 @@ SourceControlPanel::DetachedFromWindow()
 	if (Window()->LockLooper()) {
 		Window()->StopWatching(this, MSG_NOTIFY_PROJECT_LIST_CHANGED);
 		Window()->StopWatching(this, MSG_NOTIFY_PROJECT_SET_ACTIVE);
+		Window()->StopWatching(this, MSG_NOTIFY_GIT_STATUS_CHANGED);
 
 		auto gwin = static_cast<GenioWindow *>(Window());
 		if (gwin != nullptr) {
@@ -282,6 +370,7 @@ SourceControlPanel::MessageReceived(BMessage *message)
 							fProjectMenu->MakeEmpty();
 							fBranchMenu->MakeEmpty();
 							fRepositoryView->MakeEmpty();
+							_EmptyChangesView();
 							fSelectedProjectPath = "";
 						} else {
 							_UpdateProjectList();
@@ -297,6 +386,12 @@ SourceControlPanel::MessageReceived(BMessage *message)
 							_UpdateProjectList();
 						break;
 					}
+					case MSG_NOTIFY_GIT_STATUS_CHANGED:
+					{
+						if (fSelectedProjectPath == message->GetString("project", ""))
+							_ApplyStatusChanges(message);
+						break;
+					}
 					case B_PATH_MONITOR:
 					{
 						if (fProjectList->IsEmpty())
@@ -634,6 +729,10 @@ SourceControlPanel::_ChangeProject(BMessage *message)
 				} catch(const GitException &ex) {
 					LogInfo(" %s repository has no valid info", selectedProject->Name().String());
 				}
+				_UpdateChangesView();
+				// files modified in place are not notified by the path monitor
+				if (sender == kSenderProjectOptionList && selectedProject->GetGitStatus() != nullptr)
+					selectedProject->GetGitStatus()->Refresh();
 				fMainLayout->SetVisibleItem(kMainIndexRepository);
 			}
 		} else {
@@ -9,6 +9,9 @@
 #include <LayoutBuilder.h>
 #include <ObjectList.h>
 
+#include <map>
+#include <string>
+
 #include "OptionList.h"
 #include "ToolBar.h"
 
@@ -45,6 +48,8 @@ const char* const kSenderRepositoryPopupMenu = "RepositoryPopupMenu";
 const char* const kSenderExternalEvent = "ExternalEvent";
 
 class BCheckBox;
+class BListView;
+class BStringItem;
 class ProjectFolder;
 class RepositoryView;
 class BScrollView;
@@ -67,6 +72,8 @@ private:
 	RepositoryView*			fRepositoryView;
 	BScrollView*			fRepositoryViewScroll;
 	BView*					fChangesView;
+	BListView*				fChangesList;
+	std::map<std::string, BStringItem*>	fChangedFiles;
 	BView*					fLogView;
 	BView*					fRepositoryNotInitializedView;
 	const BObjectList<ProjectFolder>* fProjectList;
@@ -84,6 +91,9 @@ private:
 	void					_InitRepositoryView();
 	void					_UpdateRepositoryView();
 	void					_InitChangesView();
+	void					_UpdateChangesView();
+	void					_ApplyStatusChanges(BMessage* message);
+	void					_EmptyChangesView();
 	void					_InitLogView();
 	void					_InitRepositoryNotInitializedView();
 
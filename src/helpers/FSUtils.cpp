@@ -140,9 +140,21 @@ FSCopyFile(BEntry *src, BEntry *dest, bool clobber)
 	delete srcfile;
 	delete destfile;
 
-	// copy attributes
+	return FSCopyAttributes(src, dest);
+}
+
+
+status_t
+FSCopyAttributes(BEntry *src, BEntry *dest)
+{
 	BNode srcnode(src);
 	BNode destnode(dest);
+	status_t status = srcnode.InitCheck();
+	if (status != B_OK)
+		return status;
+	if ((status = destnode.InitCheck()) != B_OK)
+		return status;
+
 	srcnode.RewindAttrs();
 	char attr_name[B_ATTR_NAME_LENGTH];
 	while (srcnode.GetNextAttrName(attr_name) == B_OK) {
@@ -159,10 +171,10 @@ FSCopyFile(BEntry *src, BEntry *dest, bool clobber)
 		ssize_t attr_size = srcnode.ReadAttr(attr_name, attr_info.type, 0LL, attr_buffer, attr_info.size);
 
 		destnode.WriteAttr(attr_name, attr_info.type, 0LL, attr_buffer, attr_size);
-		destnode.Sync();
 
 		delete[] attr_buffer;
 	}
+	destnode.Sync();
 
 	return B_OK;
 }
@@ -18,6 +18,7 @@ class BEntry;
 namespace fs = std::filesystem;
 status_t FSCheckCopiable(BEntry *src, BEntry *dest);
 status_t FSCopyFile(BEntry *src, BEntry *dest, bool clobber);
+status_t FSCopyAttributes(BEntry *src, BEntry *dest);
 status_t FSMoveFile(BEntry *src, BEntry *dest, bool clobber);
 status_t FSMakeWritable(const fs::path& path, bool recurse = false);
 status_t FSDeleteFolder(BEntry *dirEntry);
@@ -0,0 +1,523 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+
+#include "FindInFilesThread.h"
+
+#include <Autolock.h>
+#include <Message.h>
+#include <StringList.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Log.h"
+
+// as "grep -I": a file with a NUL byte in its first block is binary
+static const size_t kBinaryCheckSize = 32 * 1024;
+static const size_t kDequeueBatch = 16;
+// lines found before waiting for MoreResults()
+static const int32 kResultLimit = 5000;
+// a file with many matches is reported in parts of this size
+static const size_t kFileResultBatch = 256;
+
+
+static inline bool
+IsWordCharacter(char c)
+{
+	// bytes of multibyte UTF-8 sequences are considered part of a word
+	return isalnum((unsigned char)c) || c == '_' || (unsigned char)c >= 0x80;
+}
+
+
+FindInFilesThread::FindInFilesThread(const BMessenger& target, const BString& text,
+	bool wholeWord, bool caseSensitive, const BString& path, const BString& excludeDirectories,
+	ProjectIndex* index)
+	:
+	fTarget(target),
+	fPattern(text.String()),
+	fWholeWord(wholeWord),
+	fCaseSensitive(caseSensitive),
+	fPath(path.String()),
+	fExcludeString(excludeDirectories),
+	fIndex(index),
+	fIndexUsed(false),
+	fThread(-1),
+	fStopRequested(false),
+	fQueueLock("FindInFiles queue"),
+	fQueueSem(create_sem(0, "FindInFiles queue")),
+	fWalkDone(false),
+	fWorkerCount(1),
+	fResultLock("FindInFiles results"),
+	fResultsNotified(false),
+	fPaused(false),
+	fMoreSem(create_sem(0, "FindInFiles more results")),
+	fLimit(kResultLimit),
+	fScannedFiles(0),
+	fMatchedLines(0)
+{
+	if (!fCaseSensitive) {
+		for (char& c : fPattern)
+			c = tolower((unsigned char)c);
+	}
+
+	while (fPath.length() > 1 && fPath.back() == '/')
+		fPath.pop_back();
+
+	BStringList directories;
+	excludeDirectories.Split(",", true, directories);
+	for (int32 i = 0; i < directories.CountStrings(); i++) {
+		BString directory = directories.StringAt(i);
+		directory.Trim();
+		if (!directory.IsEmpty())
+			fExcludeDirectories.push_back(directory);
+	}
+}
+
+
+FindInFilesThread::~FindInFilesThread()
+{
+	Stop();
+	if (fThread >= 0) {
+		status_t exitValue;
+		wait_for_thread(fThread, &exitValue);
+	}
+	delete_sem(fQueueSem);
+	delete_sem(fMoreSem);
+}
+
+
+status_t
+FindInFilesThread::Start()
+{
+	if (fPattern.empty())
+		return B_BAD_VALUE;
+
+	fThread = spawn_thread(_RunThread, "FindInFiles", B_NORMAL_PRIORITY, this);
+	if (fThread < 0)
+		return fThread;
+
+	return resume_thread(fThread);
+}
+
+
+void
+FindInFilesThread::Stop()
+{
+	fStopRequested = true;
+	// wake up the workers waiting for MoreResults()
+	release_sem_etc(fMoreSem, fWorkerCount, 0);
+}
+
+
+bool
+FindInFilesThread::TakeResults(std::vector<FileResult>& results, size_t maxLines)
+{
+	BAutolock lock(fResultLock);
+	size_t lines = 0;
+	while (!fResults.empty()
+		&& (lines == 0 || lines + fResults.front().lines.size() <= maxLines)) {
+		lines += fResults.front().lines.size();
+		results.push_back(std::move(fResults.front()));
+		fResults.pop_front();
+	}
+	if (fResults.empty()) {
+		fResultsNotified = false;
+		return false;
+	}
+	return true;
+}
+
+
+bool
+FindInFilesThread::IsPaused() const
+{
+	BAutolock lock(fResultLock);
+	return fPaused;
+}
+
+
+void
+FindInFilesThread::MoreResults()
+{
+	{
+		BAutolock lock(fResultLock);
+		if (!fPaused)
+			return;
+		fPaused = false;
+		fLimit += kResultLimit;
+	}
+	release_sem_etc(fMoreSem, fWorkerCount, 0);
+}
+
+
+/* static */
+status_t
+FindInFilesThread::_RunThread(void* cookie)
+{
+	static_cast<FindInFilesThread*>(cookie)->_Run();
+	return B_OK;
+}
+
+
+/* static */
+status_t
+FindInFilesThread::_WorkerThread(void* cookie)
+{
+	static_cast<FindInFilesThread*>(cookie)->_Work();
+	return B_OK;
+}
+
+
+void
+FindInFilesThread::_Run()
+{
+	bigtime_t start = system_time();
+
+	system_info info;
+	int32 count = 1;
+	if (get_system_info(&info) == B_OK)
+		count = std::max((int32)info.cpu_count, (int32)1);
+
+	fWorkerCount = count;
+	std::vector<thread_id> workers;
+	for (int32 i = 0; i < count; i++) {
+		thread_id worker = spawn_thread(_WorkerThread, "FindInFiles worker",
+			B_NORMAL_PRIORITY, this);
+		if (worker < 0)
+			break;
+		workers.push_back(worker);
+		resume_thread(worker);
+	}
+
+	if (workers.empty()) {
+		// no threads available: let's do the job ourselves
+		_CollectFiles();
+		fWalkDone = true;
+		_Work();
+	} else {
+		_CollectFiles();
+		{
+			BAutolock lock(fQueueLock);
+			fWalkDone = true;
+		}
+		// wake up every worker waiting for files
+		release_sem_etc(fQueueSem, workers.size(), 0);
+
+		for (thread_id worker : workers) {
+			status_t exitValue;
+			wait_for_thread(worker, &exitValue);
+		}
+	}
+
+	LogInfo("Find in files: %d files searched, %d lines found in %" B_PRId64 " ms (%d threads%s)",
+		(int32)fScannedFiles, (int32)fMatchedLines, (system_time() - start) / 1000,
+		(int32)workers.size(), fIndexUsed ? ", indexed" : "");
+
+	// a stopped search is deleted by its target: nothing more to report
+	if (fStopRequested)
+		return;
+
+	BMessage done(MSG_SEARCH_DONE);
+	done.AddInt32("files", fScannedFiles);
+	done.AddInt32("lines", fMatchedLines);
+	fTarget.SendMessage(&done);
+}
+
+
+void
+FindInFilesThread::_Work()
+{
+	std::vector<std::string> files;
+	files.reserve(kDequeueBatch);
+	while (!fStopRequested) {
+		if (!fWalkDone && acquire_sem(fQueueSem) != B_OK)
+			break;
+
+		files.clear();
+		if (!_DequeueFiles(files))
+			break;
+
+		for (const std::string& file : files) {
+			if (fStopRequested)
+				break;
+			_SearchFile(file);
+		}
+	}
+}
+
+
+void
+FindInFilesThread::_CollectFiles()
+{
+	if (fIndex.IsSet()) {
+		std::vector<std::string> files;
+		status_t status = fIndex->Query(fPattern, fExcludeString, files);
+		if (status == B_OK) {
+			fIndexUsed = true;
+			for (std::string& file : files)
+				_EnqueueFile(std::move(file));
+			return;
+		}
+		LogDebug("Find in files: index not used: %s", ::strerror(status));
+	}
+	_WalkDirectory(fPath);
+}
+
+
+void
+FindInFilesThread::_WalkDirectory(const std::string& path)
+{
+	DIR* dir = opendir(path.c_str());
+	if (dir == nullptr)
+		return;
+
+	struct dirent* entry;
+	while (!fStopRequested && (entry = readdir(dir)) != nullptr) {
+		const char* name = entry->d_name;
+		if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+			continue;
+
+		std::string child(path);
+		child.append("/").append(name);
+
+		// as grep -r, symbolic links are not followed
+		struct stat st;
+		if (lstat(child.c_str(), &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			if (!_IsExcluded(name))
+				_WalkDirectory(child);
+		} else if (S_ISREG(st.st_mode) && st.st_size > 0) {
+			_EnqueueFile(std::move(child));
+		}
+	}
+	closedir(dir);
+}
+
+
+bool
+FindInFilesThread::_IsExcluded(const char* name) const
+{
+	for (const BString& pattern : fExcludeDirectories) {
+		if (fnmatch(pattern.String(), name, 0) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+void
+FindInFilesThread::_EnqueueFile(std::string&& path)
+{
+	{
+		BAutolock lock(fQueueLock);
+		fQueue.push_back(std::move(path));
+	}
+	release_sem_etc(fQueueSem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+bool
+FindInFilesThread::_DequeueFiles(std::vector<std::string>& files)
+{
+	BAutolock lock(fQueueLock);
+	if (fQueue.empty())
+		return !fWalkDone;
+
+	while (!fQueue.empty() && files.size() < kDequeueBatch) {
+		files.push_back(std::move(fQueue.front()));
+		fQueue.pop_front();
+	}
+	return true;
+}
+
+
+void
+FindInFilesThread::_SearchFile(const std::string& path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return;
+	}
+
+	const size_t size = st.st_size;
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+		return;
+
+	fScannedFiles++;
+
+	const char* begin = static_cast<const char*>(mapped);
+	const char* end = begin + size;
+	if (memchr(begin, '\0', std::min(size, kBinaryCheckSize)) != nullptr) {
+		munmap(mapped, size);
+		return;
+	}
+
+	FileResult result;
+	result.path = path;
+
+	const char* lineStart = begin;
+	const char* position = begin;
+	int32 lineNumber = 1;
+	const char* match;
+	while (!fStopRequested && (match = _FindNext(position, end)) != nullptr) {
+		if (fWholeWord && !_IsWholeWord(match, begin, end)) {
+			position = match + 1;
+			continue;
+		}
+
+		if (fMatchedLines >= fLimit) {
+			_AddResult(result);
+			_WaitForMoreResults();
+			if (fStopRequested)
+				break;
+		}
+
+		const char* newLine;
+		while ((newLine = (const char*)memchr(lineStart, '\n', match - lineStart)) != nullptr) {
+			lineNumber++;
+			lineStart = newLine + 1;
+		}
+		const char* lineEnd = (const char*)memchr(match, '\n', end - match);
+		if (lineEnd == nullptr)
+			lineEnd = end;
+
+		size_t length = std::min((size_t)(lineEnd - lineStart), (size_t)MAX_LINE_LEN);
+		if (length > 0 && lineStart[length - 1] == '\r')
+			length--;
+
+		result.lines.push_back({ lineNumber, std::string(lineStart, length) });
+		fMatchedLines++;
+		if (result.lines.size() >= kFileResultBatch)
+			_AddResult(result);
+
+		if (lineEnd == end)
+			break;
+
+		// one report per line, as grep
+		position = lineStart = lineEnd + 1;
+		lineNumber++;
+	}
+
+	munmap(mapped, size);
+
+	if (!fStopRequested)
+		_AddResult(result);
+}
+
+
+void
+FindInFilesThread::_AddResult(FileResult& result)
+{
+	if (result.lines.empty())
+		return;
+
+	bool notify;
+	{
+		BAutolock lock(fResultLock);
+		fResults.push_back(FileResult());
+		fResults.back().path = result.path;
+		fResults.back().lines.swap(result.lines);
+		notify = !fResultsNotified;
+		fResultsNotified = true;
+	}
+	if (notify) {
+		BMessage message(MSG_REPORT_RESULT);
+		fTarget.SendMessage(&message);
+	}
+}
+
+
+void
+FindInFilesThread::_WaitForMoreResults()
+{
+	while (!fStopRequested && fMatchedLines >= fLimit) {
+		bool notify;
+		{
+			BAutolock lock(fResultLock);
+			fPaused = true;
+			// the target must know, even if there is nothing new to take
+			notify = !fResultsNotified;
+			fResultsNotified = true;
+		}
+		if (notify) {
+			BMessage message(MSG_REPORT_RESULT);
+			fTarget.SendMessage(&message);
+		}
+		if (acquire_sem(fMoreSem) != B_OK)
+			break;
+	}
+}
+
+
+const char*
+FindInFilesThread::_FindNext(const char* start, const char* end) const
+{
+	// memchr() on the first byte of the pattern, then compare the rest
+	const size_t length = fPattern.length();
+	const char* pattern = fPattern.data();
+	const char lower = pattern[0];
+	const char upper = fCaseSensitive ? lower : toupper((unsigned char)lower);
+
+	while ((size_t)(end - start) >= length) {
+		const size_t span = end - start - length + 1;
+		const char* candidate = (const char*)memchr(start, lower, span);
+		if (upper != lower) {
+			// only look for the other case before the first hit
+			size_t upperSpan = candidate != nullptr ? candidate - start : span;
+			const char* other = (const char*)memchr(start, upper, upperSpan);
+			if (other != nullptr)
+				candidate = other;
+		}
+		if (candidate == nullptr)
+			return nullptr;
+
+		bool found;
+		if (fCaseSensitive) {
+			found = memcmp(candidate + 1, pattern + 1, length - 1) == 0;
+		} else {
+			found = true;
+			for (size_t i = 1; i < length; i++) {
+				if (tolower((unsigned char)candidate[i]) != (unsigned char)pattern[i]) {
+					found = false;
+					break;
+				}
+			}
+		}
+		if (found)
+			return candidate;
+
+		start = candidate + 1;
+	}
+	return nullptr;
+}
+
+
+bool
+FindInFilesThread::_IsWholeWord(const char* match, const char* begin, const char* end) const
+{
+	const char* after = match + fPattern.length();
+	if (match > begin && IsWordCharacter(match[-1]))
+		return false;
+	if (after < end && IsWordCharacter(*after))
+		return false;
+	return true;
+}
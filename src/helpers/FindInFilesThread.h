@@ -0,0 +1,111 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#pragma once
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <Referenceable.h>
+#include <String.h>
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "ProjectIndex.h"
+
+#define MAX_LINE_LEN B_PATH_NAME_LENGTH * 2
+
+enum {
+	MSG_REPORT_RESULT = 'mrre',
+	MSG_SEARCH_DONE = 'mgrd'
+};
+
+// In-process replacement of "grep -IFHrn": a walker thread enumerates the
+// project files while a pool of worker threads (one per CPU) searches them,
+// each one mapped in memory, for a literal string.
+// When a ProjectIndex is available, only the files it reports as candidates
+// are searched.
+// The matches are queued as FileResult and the target receives a
+// MSG_REPORT_RESULT message (without data) when some are available: the
+// next one is sent only after the target has called TakeResults().
+// After kResultLimit lines have been found the workers wait for the target
+// to call MoreResults(); MSG_SEARCH_DONE is sent when the search is over.
+
+class FindInFilesThread {
+public:
+	struct Line {
+		int32			number;
+		std::string		text;
+	};
+
+	struct FileResult {
+		std::string			path;
+		std::vector<Line>	lines;
+	};
+
+						FindInFilesThread(const BMessenger& target, const BString& text,
+							bool wholeWord, bool caseSensitive, const BString& path,
+							const BString& excludeDirectories, ProjectIndex* index = nullptr);
+						~FindInFilesThread();
+
+			status_t	Start();
+			void		Stop();
+
+			// Moves into 'results' the queued files, until 'maxLines' lines
+			// (at least one file). Returns true if more are queued.
+			bool		TakeResults(std::vector<FileResult>& results, size_t maxLines);
+			// the workers are waiting for MoreResults()
+			bool		IsPaused() const;
+			void		MoreResults();
+
+private:
+	static	status_t	_RunThread(void* cookie);
+	static	status_t	_WorkerThread(void* cookie);
+
+			void		_Run();
+			void		_Work();
+			void		_CollectFiles();
+			void		_WalkDirectory(const std::string& path);
+			bool		_IsExcluded(const char* name) const;
+			void		_EnqueueFile(std::string&& path);
+			bool		_DequeueFiles(std::vector<std::string>& files);
+			void		_SearchFile(const std::string& path);
+			void		_AddResult(FileResult& result);
+			void		_WaitForMoreResults();
+			const char*	_FindNext(const char* start, const char* end) const;
+			bool		_IsWholeWord(const char* match, const char* begin,
+							const char* end) const;
+
+	BMessenger					fTarget;
+	std::string					fPattern;
+	bool						fWholeWord;
+	bool						fCaseSensitive;
+	std::string					fPath;
+	BString						fExcludeString;
+	std::vector<BString>		fExcludeDirectories;
+	BReference<ProjectIndex>	fIndex;
+	bool						fIndexUsed;
+
+	thread_id					fThread;
+	std::atomic<bool>			fStopRequested;
+
+	BLocker						fQueueLock;
+	sem_id						fQueueSem;
+	std::deque<std::string>		fQueue;
+	std::atomic<bool>			fWalkDone;
+	int32						fWorkerCount;
+
+	mutable BLocker				fResultLock;
+	std::deque<FileResult>		fResults;
+	bool						fResultsNotified;
+	bool						fPaused;
+	sem_id						fMoreSem;
+	std::atomic<int32>			fLimit;
+
+	std::atomic<int32>			fScannedFiles;
+	std::atomic<int32>			fMatchedLines;
+};
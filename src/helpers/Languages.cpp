@@ -11,6 +11,8 @@
 #include <map>
 #include <string>
 
+#include <sys/stat.h>
+
 #include <Catalog.h>
 #include <Directory.h>
 #include <FindDirectory.h>
@@ -33,6 +35,7 @@
 std::vector<std::string>			Languages::sLanguages;
 std::map<std::string, std::string>	Languages::sMenuItems;
 std::map<std::string, std::string> 	Languages::sExtensions;
+std::map<std::string, Languages::Definition>	Languages::sDefinitions;
 
 
 namespace {
@@ -131,16 +134,7 @@ Languages::ApplyLanguage(Editor* editor, const char* lang)
 }
 
 /**
- * Loads YAML file with language specification:
- *   lexer: string (required)
- *   properties: (string|string) map -> SCI_SETPROPERTY
- *   keywords: (index(int)|string) map -> SCI_SETKEYWORDS
- *   identifiers: (lexem class id(int)|(string array)) map -> SCI_SETIDENTIFIERS
- *   comments:
- *     line: string
- *     block: pair of strings
- *   styles: (lexem class id(int)|Koder style id(int)) map
- *   substyles: (lexem class id(int)|(Koder style id(int)) array) map
+ * Applies the language specification loaded by _GetDefinition().
  *
  * For substyles, strings in identifiers array are matched with styles in
  * substyles array. Array instead of map is used because substyles are allocated
@@ -159,20 +153,11 @@ Languages::_ApplyLanguage(Editor* editor, const char* lang, const BPath &path)
 		return {};
 	// TODO: early exit if lexer not changed
 
-	BPath p = path;
-	p.Append("languages");
-	p.Append(lang);
-	BString fileName(p.Path());
-	fileName.Append(".yaml");
-	if (!BEntry(fileName.String()).Exists()) {
-		// TODO: Workaround for a bug in Haiku x86_32: exceptions
-		// thrown inside yaml_cpp aren't catchable. We throw this exception
-		// inside Genio and that works.
-		throw YAML::BadFile(fileName.String());
-	}
-	const YAML::Node language = YAML::LoadFile(std::string(p.Path()) + ".yaml");
-	std::string lexerName = language["lexer"].as<std::string>();
-	Scintilla::ILexer5* lexer;
+	const Definition* language = _GetDefinition(lang, path);
+	if (language == nullptr)
+		return {};
+
+	Scintilla::ILexer5* lexer = nullptr;
 	// sLexerLibraries contains libraries in the following order:
 	// * system
 	// * user
@@ -180,7 +165,7 @@ Languages::_ApplyLanguage(Editor* editor, const char* lang, const BPath &path)
 	// * non-packaged user
 	// Going in reverse results in correct override hierarchy.
 	for(auto it = sLexerLibraries.rbegin(); it != sLexerLibraries.rend(); ++it) {
-		lexer = (*it)->CreateLexer(lexerName.c_str());
+		lexer = (*it)->CreateLexer(language->lexer.c_str());
 		if(lexer != nullptr)
 			break;
 	}
@@ -190,69 +175,142 @@ Languages::_ApplyLanguage(Editor* editor, const char* lang, const BPath &path)
 
 	editor->SendMessage(SCI_SETILEXER, 0, reinterpret_cast<sptr_t>(lexer));
 
+	for(const auto& property : language->properties) {
+		editor->SendMessage(SCI_SETPROPERTY, (uptr_t) property.first.c_str(),
+			(sptr_t) property.second.c_str());
+	}
+
+	for(const auto& keyword : language->keywords)
+		editor->SendMessage(SCI_SETKEYWORDS, keyword.first, (sptr_t) keyword.second.c_str());
+
+	std::unordered_map<int, int> substyleStartMap;
+	for(const auto& id : language->identifiers) {
+		// TODO: allocate only once
+		const int start = editor->SendMessage(SCI_ALLOCATESUBSTYLES,
+			id.first, id.second.size());
+		substyleStartMap.emplace(id.first, start);
+		int i = 0;
+		for(const auto& idents : id.second) {
+			editor->SendMessage(SCI_SETIDENTIFIERS, start + i++,
+				reinterpret_cast<sptr_t>(idents.c_str()));
+		}
+	}
+
+	if(language->hasLineComment)
+		editor->SetCommentLineToken(language->lineComment);
+	if(language->hasBlockComment)
+		editor->SetCommentBlockTokens(language->blockComment.first,
+			language->blockComment.second);
+
+	std::map<int, int> styleMap = language->styles;
+	for(const auto& id : language->substyles) {
+		int i = 0;
+		for(const int styleId : id.second) {
+			const int substyleStart = substyleStartMap[id.first];
+			styleMap.emplace(substyleStart + i++, styleId);
+		}
+	}
+	return styleMap;
+}
+
+
+/**
+ * Loads YAML file with language specification:
+ *   lexer: string (required)
+ *   properties: (string|string) map -> SCI_SETPROPERTY
+ *   keywords: (index(int)|string) map -> SCI_SETKEYWORDS
+ *   identifiers: (lexem class id(int)|(string array)) map -> SCI_SETIDENTIFIERS
+ *   comments:
+ *     line: string
+ *     block: pair of strings
+ *   styles: (lexem class id(int)|Koder style id(int)) map
+ *   substyles: (lexem class id(int)|(Koder style id(int)) array) map
+ *
+ * Each file is parsed only once and kept until it's modified.
+ * Returns nullptr if the file doesn't exist.
+ */
+/* static */ const Languages::Definition*
+Languages::_GetDefinition(const char* lang, const BPath &path)
+{
+	BPath p = path;
+	p.Append("languages");
+	p.Append(lang);
+	const std::string fileName = std::string(p.Path()) + ".yaml";
+
+	struct stat st;
+	if (stat(fileName.c_str(), &st) != 0) {
+		sDefinitions.erase(fileName);
+		return nullptr;
+	}
+	const int64 modified = (int64)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+
+	auto found = sDefinitions.find(fileName);
+	if (found != sDefinitions.end() && found->second.modified == modified)
+		return &found->second;
+
+	const bigtime_t start = system_time();
+	const YAML::Node language = YAML::LoadFile(fileName);
+
+	Definition definition;
+	definition.modified = modified;
+	definition.lexer = language["lexer"].as<std::string>();
+
 	for(const auto& property : language["properties"]) {
-		auto name = property.first.as<std::string>();
-		auto value = property.second.as<std::string>();
-		editor->SendMessage(SCI_SETPROPERTY, (uptr_t) name.c_str(), (sptr_t) value.c_str());
+		definition.properties.emplace_back(property.first.as<std::string>(),
+			property.second.as<std::string>());
 	}
 
 	for(const auto& keyword : language["keywords"]) {
-		auto num = keyword.first.as<int>();
-		auto words = keyword.second.as<std::string>();
-		editor->SendMessage(SCI_SETKEYWORDS, num, (sptr_t) words.c_str());
+		definition.keywords.emplace_back(keyword.first.as<int>(),
+			keyword.second.as<std::string>());
 	}
 
-	std::unordered_map<int, int> substyleStartMap;
 	const auto& identifiers = language["identifiers"];
 	if(identifiers && identifiers.IsMap()) {
 		for(const auto& id : identifiers) {
 			if(!id.second.IsSequence())
 				continue;
-
-			const int substyleId = id.first.as<int>();
-			// TODO: allocate only once
-			const int start = editor->SendMessage(SCI_ALLOCATESUBSTYLES,
-				substyleId, id.second.size());
-			substyleStartMap.emplace(substyleId, start);
-			int i = 0;
-			for(const auto& idents : id.second) {
-				editor->SendMessage(SCI_SETIDENTIFIERS, start + i++,
-					reinterpret_cast<sptr_t>(idents.as<std::string>().c_str()));
-			}
+			definition.identifiers.emplace_back(id.first.as<int>(),
+				id.second.as<std::vector<std::string>>());
 		}
 	}
 
+	definition.hasLineComment = false;
+	definition.hasBlockComment = false;
 	const YAML::Node comments = language["comments"];
-
 	if(comments) {
 		const YAML::Node line = comments["line"];
-		if(line)
-			editor->SetCommentLineToken(line.as<std::string>());
+		if(line) {
+			definition.hasLineComment = true;
+			definition.lineComment = line.as<std::string>();
+		}
 		const YAML::Node block = comments["block"];
-		if(block && block.IsSequence())
-			editor->SetCommentBlockTokens(block[0].as<std::string>(),
-				block[1].as<std::string>());
+		if(block && block.IsSequence()) {
+			definition.hasBlockComment = true;
+			definition.blockComment = { block[0].as<std::string>(),
+				block[1].as<std::string>() };
+		}
 	}
 
-	std::map<int, int> styleMap;
 	const YAML::Node styles = language["styles"];
 	if(styles) {
-		styleMap = styles.as<std::map<int, int>>();
+		definition.styles = styles.as<std::map<int, int>>();
 	}
 	const YAML::Node substyles = language["substyles"];
 	if(substyles && substyles.IsMap()) {
 		for(const auto& id : substyles) {
 			if(!id.second.IsSequence())
 				continue;
-
-			int i = 0;
-			for(const auto& styleId : id.second) {
-				const int substyleStart = substyleStartMap[id.first.as<int>()];
-				styleMap.emplace(substyleStart + i++, styleId.as<int>());
-			}
+			definition.substyles.emplace_back(id.first.as<int>(),
+				id.second.as<std::vector<int>>());
 		}
 	}
-	return styleMap;
+
+	LogTrace("Language %s loaded in %" B_PRId64 " us", fileName.c_str(), system_time() - start);
+
+	Definition& cached = sDefinitions[fileName];
+	cached = std::move(definition);
+	return &cached;
 }
 
 
@@ -9,8 +9,11 @@
 
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <SupportDefs.h>
+
 
 class BPath;
 class Editor;
@@ -27,11 +30,28 @@ public:
 	static	void								LoadLanguages();
 
 private:
+	// A language file, as read from one of the data directories
+	struct Definition {
+		int64											modified;
+		std::string										lexer;
+		std::vector<std::pair<std::string, std::string>>	properties;
+		std::vector<std::pair<int, std::string>>		keywords;
+		std::vector<std::pair<int, std::vector<std::string>>>	identifiers;
+		bool											hasLineComment;
+		std::string										lineComment;
+		bool											hasBlockComment;
+		std::pair<std::string, std::string>				blockComment;
+		std::map<int, int>								styles;
+		std::vector<std::pair<int, std::vector<int>>>	substyles;
+	};
+
 	static	void								_LoadLanguages(const BPath& path);
 	static	std::map<int, int>					_ApplyLanguage(Editor* editor, const char* lang, const BPath &path);
+	static	const Definition*					_GetDefinition(const char* lang, const BPath &path);
 	static	std::vector<std::string>			sLanguages;
 	static	std::map<std::string, std::string>	sMenuItems;
 	static	std::map<std::string, std::string> 	sExtensions;
+	static	std::map<std::string, Definition>	sDefinitions;
 };
 
 
@@ -9,6 +9,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include <sys/stat.h>
+
 #include <yaml-cpp/yaml.h>
 
 #include <Alert.h>
@@ -83,6 +85,7 @@ struct convert<Styler::Style> {
 
 
 std::unordered_map<int, Styler::Style>	Styler::sStylesMapping;
+std::map<std::string, Styler::StyleFile>	Styler::sStyleFiles;
 
 
 /* static */ void
@@ -103,27 +106,12 @@ Styler::ApplyGlobal(Editor* editor, const char* style, const BFont* font)
 /* static */ void
 Styler::_ApplyGlobal(Editor* editor, const char* style, const BPath &path, const BFont* font)
 {
-	BPath p(path);
-	p.Append("styles");
-	p.Append(style);
-	BString fileName(p.Path());
-	fileName.Append(".yaml");
-	if (!BEntry(fileName.String()).Exists()) {
-		// TODO: Workaround for a bug in Haiku x86_32: exceptions 
-		// thrown inside yaml_cpp aren't catchable. We throw this exception
-		// inside Genio and that works.
-		throw YAML::BadFile(fileName.String());
-	}
-	const YAML::Node styles = YAML::LoadFile(std::string(p.Path()) + ".yaml");
-	YAML::Node global;
-	if(styles["Global"]) {
-		global = styles["Global"];
-	}
+	const StyleFile* styles = _GetStyleFile(style, path);
+	if (styles == nullptr)
+		return;
 
-	int id;
-	Style s;
-	if(global["Default"]) {
-		_GetAttributesFromNode(global["Default"], id, s);
+	if(styles->hasDefault) {
+		const Style& s = styles->defaultStyle;
 
 		if(font == nullptr)
 			font = be_fixed_font;
@@ -147,9 +135,10 @@ Styler::_ApplyGlobal(Editor* editor, const char* style, const BPath &path, const
 		editor->SendMessage(SCI_INDICSETSTYLE, INDIC_IME+1, INDIC_FULLBOX);
 		editor->SendMessage(SCI_INDICSETFORE, INDIC_IME+1, 0x0000FF);
 	}
-	for(const auto &node : global) {
-		std::string name = node.first.as<std::string>();
-		_GetAttributesFromNode(node.second, id, s);
+	for(const auto &node : styles->global) {
+		const std::string& name = node.first;
+		const int id = node.second.first;
+		const Style& s = node.second.second;
 		if(id != -1) {
 			_ApplyAttributes(editor, id, s);
 			sStylesMapping.emplace(id, s);
@@ -215,12 +204,61 @@ Styler::_ApplyGlobal(Editor* editor, const char* style, const BPath &path, const
 			}
 		}
 	}
+	for(const auto& style : styles->styles)
+		sStylesMapping.emplace(style.first, style.second);
+}
+
+
+/* static */ const Styler::StyleFile*
+Styler::_GetStyleFile(const char* style, const BPath &path)
+{
+	BPath p(path);
+	p.Append("styles");
+	p.Append(style);
+	const std::string fileName = std::string(p.Path()) + ".yaml";
+
+	// each file is parsed only once and kept until it's modified
+	struct stat st;
+	if (stat(fileName.c_str(), &st) != 0) {
+		sStyleFiles.erase(fileName);
+		return nullptr;
+	}
+	const int64 modified = (int64)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+
+	auto found = sStyleFiles.find(fileName);
+	if (found != sStyleFiles.end() && found->second.modified == modified)
+		return &found->second;
+
+	const YAML::Node styles = YAML::LoadFile(fileName);
+	YAML::Node global;
+	if(styles["Global"]) {
+		global = styles["Global"];
+	}
+
+	StyleFile styleFile;
+	styleFile.modified = modified;
+	int id;
+	Style s;
+	styleFile.hasDefault = false;
+	if(global["Default"]) {
+		_GetAttributesFromNode(global["Default"], id, s);
+		styleFile.hasDefault = true;
+		styleFile.defaultStyle = s;
+	}
+	for(const auto &node : global) {
+		_GetAttributesFromNode(node.second, id, s);
+		styleFile.global.push_back({ node.first.as<std::string>(), { id, s } });
+	}
 	for(const auto& style : styles) {
 		if(style.first.as<std::string>() == "Global")
 			continue;
 		_GetAttributesFromNode(style.second, id, s);
-		sStylesMapping.emplace(id, s);
+		styleFile.styles.emplace_back(id, s);
 	}
+
+	StyleFile& cached = sStyleFiles[fileName];
+	cached = std::move(styleFile);
+	return &cached;
 }
 
 
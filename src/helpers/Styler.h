@@ -11,6 +11,10 @@
 #include <string>
 #include <set>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <SupportDefs.h>
 
 #include <yaml-cpp/yaml.h>
 
@@ -35,11 +39,23 @@ public:
 	static	void	GetAvailableStyles(std::set<std::string> &styles);
 
 private:
+	// A style file, as read from one of the data directories
+	struct StyleFile {
+		int64									modified;
+		// the "Global" section, in file order
+		std::vector<std::pair<std::string, std::pair<int, Style>>>	global;
+		bool									hasDefault;
+		Style									defaultStyle;
+		std::vector<std::pair<int, Style>>		styles;
+	};
+
 	static	void	_ApplyGlobal(Editor* editor, const char* style, const BPath &path, const BFont* font = nullptr);
+	static	const StyleFile*	_GetStyleFile(const char* style, const BPath &path);
 	static	void	_GetAvailableStyles(std::set<std::string> &styles, const BPath &path);
 	static	void	_GetAttributesFromNode(const YAML::Node &node, int& styleId, Style& style);
 	static	void	_ApplyAttributes(Editor* editor, int styleId, Style style);
 	static	std::unordered_map<int, Style>	sStylesMapping;
+	static	std::map<std::string, StyleFile>	sStyleFiles;
 };
 
 
@@ -6,6 +6,8 @@
 
 #include "TextUtils.h"
 #include <algorithm>
+#include <cctype>
+#include <strings.h>
 
 const std::string kWordCharacters ("_abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789");
 const std::string kWhiteSpaces (" \n\t\r");
@@ -32,3 +34,41 @@ void LeftTrim(std::string &s) {
           }));
 }
 
+
+int FuzzyScore(const std::string& pattern, const std::string& text) noexcept {
+	if (pattern.empty())
+		return 0;
+	if (pattern.length() > text.length())
+		return -1;
+
+	// most of the candidates are discarded or accepted here
+	if (strncasecmp(pattern.c_str(), text.c_str(), pattern.length()) == 0) {
+		int score = 1000 - (int)(text.length() - pattern.length());
+		if (text.compare(0, pattern.length(), pattern) == 0)
+			score += 100;
+		return score;
+	}
+
+	int score = 0;
+	size_t p = 0;
+	size_t last = std::string::npos;
+	for (size_t t = 0; t < text.length() && p < pattern.length(); t++) {
+		const unsigned char ch = text[t];
+		if (std::tolower(ch) != std::tolower((unsigned char)pattern[p]))
+			continue;
+
+		score += 1;
+		if (last != std::string::npos && last + 1 == t)
+			score += 5;
+		const unsigned char prev = t > 0 ? text[t - 1] : '_';
+		if (prev == '_' || (std::isupper(ch) && std::islower(prev)))
+			score += 10;
+		else if (last != std::string::npos)
+			score -= std::min((int)(t - last - 1), 3);
+		last = t;
+		p++;
+	}
+	if (p < pattern.length())
+		return -1;
+	return std::max(score, 0);
+}
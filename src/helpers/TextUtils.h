@@ -21,5 +21,11 @@ const BString EscapeQuotesWrap(const BString& string);
 // trim from start (in place)
 void LeftTrim(std::string &s);
 
+// How well 'text' matches the characters of 'pattern', in order and ignoring
+// the case: the higher the better, -1 if it doesn't match.
+// A prefix scores more than a match at the start of the words (after '_' or
+// a lowercase letter), which scores more than any other.
+int FuzzyScore(const std::string& pattern, const std::string& text) noexcept;
+
 
 #endif // TextUtils_H
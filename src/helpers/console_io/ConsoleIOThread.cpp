@@ -15,8 +15,10 @@
 #include <Debug.h>
 #include <Messenger.h>
 
+#include <algorithm>
 #include <errno.h>
 #include <image.h>
+#include <poll.h>
 #include <signal.h>
 #include <termios.h>
 #include <unistd.h>
@@ -24,15 +26,28 @@
 #include "Log.h"
 #include "PipeImage.h"
 
+// the output read is posted to the target at most this often...
+static const bigtime_t kFlushInterval = 50000;
+// ...unless there is so much of it
+static const int32 kMaxPendingOutput = 256 * 1024;
+// how often to check if the process is still alive while it's silent
+static const int kPollTimeout = 500;
+
 ConsoleIOThread::ConsoleIOThread(BMessage* cmd_message, const BMessenger& consoleTarget)
 	:
 	GenericThread("ConsoleIOThread", B_NORMAL_PRIORITY, cmd_message),
 	fTarget(consoleTarget),
 	fExternalProcessId(-1),
-	fConsoleOutput(nullptr),
-	fConsoleError(nullptr),
+	fPipesOpen(false),
+	fOutputOpen(false),
+	fErrorOpen(false),
 	fIsDone(false),
-	fFailed(false)
+	fFailed(false),
+	fLastFlush(0),
+	fStartTime(0),
+	fLineCount(0),
+	fByteCount(0),
+	fMessageCount(0)
 {
 	SetDataStore(new BMessage(*cmd_message));
 }
@@ -73,6 +88,7 @@ ConsoleIOThread::_RunExternalProcess()
 	if (status != B_OK)
 		return status;
 
+	fPipesOpen = true;
 	fExternalProcessId = fPipeImage.GetChildPid();
 
 	// lower the command priority since it is a background task.
@@ -97,20 +113,8 @@ ConsoleIOThread::_RunExternalProcess()
 	// inheriting output buffers of the main process.
 	_CleanPipes();
 
-	fConsoleOutput = fdopen(fPipeImage.GetStdOutFD(), "r");
-	if (fConsoleOutput == nullptr) {
-		LogErrorF("Can't open ConsoleOutput file! (%d) [%s]", errno, strerror(errno));
-		kill_thread(fExternalProcessId);
-		fExternalProcessId = -1;
-		return errno;
-	}
-	fConsoleError = fdopen(fPipeImage.GetStdErrFD(), "r");
-	if (fConsoleError == nullptr) {
-		LogErrorF("Can't open ConsoleError file! (%d) [%s]", errno, strerror(errno));
-		kill_thread(fExternalProcessId);
-		fExternalProcessId = -1;
-		return errno;
-	}
+	fOutputOpen = fErrorOpen = true;
+	fStartTime = fLastFlush = system_time();
 
 	return B_OK;
 }
@@ -130,39 +134,133 @@ ConsoleIOThread::ExecuteUnit()
 	if (fExternalProcessId < 0)
 		return B_NO_INIT;
 
-	// read output and error from command
-	// send it to window
-	BString outStr("");
-	BString errStr("");
-	status_t status = GetFromPipe(outStr, errStr);
-	if (status == B_OK) {
-		fLastOutputString += outStr;
-		fLastErrorString  += errStr;
-
-		if (!fLastOutputString.IsEmpty()) {
-			if (fLastOutputString.EndsWith("\n")) {
-				OnStdOutputLine(fLastOutputString);
-				fLastOutputString = "";
-			}
+	struct pollfd fds[2];
+	nfds_t count = 0;
+	if (fOutputOpen)
+		fds[count++] = { fPipeImage.GetStdOutFD(), POLLIN, 0 };
+	if (fErrorOpen)
+		fds[count++] = { fPipeImage.GetStdErrFD(), POLLIN, 0 };
+
+	// wake up in time to post the lines read so far
+	int timeout = kPollTimeout;
+	if (!fOutputLines.IsEmpty() || !fErrorLines.IsEmpty()) {
+		// rounded up, or poll() returns right away until it's time
+		bigtime_t flush = fLastFlush + kFlushInterval - system_time();
+		timeout = std::max((bigtime_t)1, (flush + 999) / 1000);
+	}
+
+	int ready = 0;
+	if (count > 0) {
+		ready = poll(fds, count, timeout);
+		if (ready < 0 && errno != EINTR) {
+			status_t status = errno;
+			LogErrorF("poll() failed (%d) [%s]", status, strerror(status));
+			FlushOutput(true);
+			return status;
 		}
+	}
 
-		if (!fLastErrorString.IsEmpty()) {
-			fFailed = true;
-			if (fLastErrorString.EndsWith("\n")) {
-				OnStdErrorLine(fLastErrorString);
-				fLastErrorString = "";
-			}
+	size_t bytes = 0;
+	for (nfds_t i = 0; i < count && ready > 0; i++) {
+		if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+			continue;
+		// the lines of the other stream were read before these ones
+		if (fds[i].fd == fPipeImage.GetStdOutFD()) {
+			_PostLines(fErrorLines, true);
+			if (!ReadPipe(fds[i].fd, fLastOutputString, fOutputLines, bytes))
+				fOutputOpen = false;
+		} else {
+			_PostLines(fOutputLines, false);
+			if (!ReadPipe(fds[i].fd, fLastErrorString, fErrorLines, bytes))
+				fErrorOpen = false;
 		}
+	}
 
-		if (!IsProcessAlive() && outStr.IsEmpty() && errStr.IsEmpty()) {
-			LogTrace("ExecuteUnit() done!");
-			return EOF;
+	if (!fLastErrorString.IsEmpty() || !fErrorLines.IsEmpty())
+		fFailed = true;
+
+	// a child process may keep the pipes open after the command is over
+	const bool done = (!fOutputOpen && !fErrorOpen)
+		|| (ready == 0 && bytes == 0 && !IsProcessAlive());
+	FlushOutput(done);
+
+	if (done) {
+		const bigtime_t elapsed = std::max((bigtime_t)1, system_time() - fStartTime);
+		LogInfo("ConsoleIOThread: %" B_PRId64 " lines, %" B_PRId64 " bytes in %" B_PRId64
+			" ms (%" B_PRId64 " lines/s), %d messages", fLineCount, fByteCount,
+			elapsed / 1000, fLineCount * 1000000 / elapsed, fMessageCount);
+		LogTrace("ExecuteUnit() done!");
+		return EOF;
+	}
+
+	return B_OK;
+}
+
+
+bool
+ConsoleIOThread::ReadPipe(int fd, BString& partialLine, BString& lines, size_t& bytes)
+{
+	bool open = true;
+	while (true) {
+		ssize_t length = read(fd, fReadBuffer, sizeof(fReadBuffer));
+		if (length > 0) {
+			partialLine.Append(fReadBuffer, length);
+			bytes += length;
+			fByteCount += length;
+			// a pipe is drained by a short read
+			if ((size_t)length < sizeof(fReadBuffer))
+				break;
+			continue;
 		}
+		if (length == 0 || (errno != EAGAIN && errno != EINTR))
+			open = false;
+		break;
+	}
+
+	// the complete lines are moved all together
+	int32 end = partialLine.FindLast('\n');
+	if (!open || partialLine.Length() > kMaxPendingOutput)
+		end = partialLine.Length() - 1;
+	if (end >= 0) {
+		const char* text = partialLine.String();
+		fLineCount += std::count(text, text + end + 1, '\n');
+		lines.Append(text, end + 1);
+		partialLine.Remove(0, end + 1);
 	}
+	return open;
+}
+
+
+void
+ConsoleIOThread::FlushOutput(bool all)
+{
+	if (fOutputLines.IsEmpty() && fErrorLines.IsEmpty())
+		return;
 
-	// streams are non blocking, sleep every 1ms
-	snooze(1000);
-	return status;
+	if (!all && system_time() - fLastFlush < kFlushInterval
+		&& fOutputLines.Length() + fErrorLines.Length() < kMaxPendingOutput) {
+		return;
+	}
+
+	// only one of them is pending, see ExecuteUnit()
+	_PostLines(fOutputLines, false);
+	_PostLines(fErrorLines, true);
+	fLastFlush = system_time();
+}
+
+
+void
+ConsoleIOThread::_PostLines(BString& lines, bool error)
+{
+	if (lines.IsEmpty())
+		return;
+
+	if (error)
+		OnStdErrorLine(lines);
+	else
+		OnStdOutputLine(lines);
+	lines.Truncate(0);
+	fMessageCount++;
 }
 
 
@@ -184,19 +282,6 @@ ConsoleIOThread::OnStdErrorLine(const BString& stdErr)
 }
 
 
-status_t
-ConsoleIOThread::GetFromPipe(BString& stdOut, BString& stdErr)
-{
-	if (fConsoleOutput) {
-		stdOut = fgets(fConsoleOutputBuffer, LINE_MAX, fConsoleOutput);
-	}
-	if (fConsoleError) {
-		stdErr = fgets(fConsoleOutputBuffer, LINE_MAX, fConsoleError);
-	}
-	return (::feof(fConsoleOutput) && ::feof(fConsoleError)) ? EOF : B_OK;
-}
-
-
 void
 ConsoleIOThread::PushInput(BString text)
 {
@@ -223,9 +308,8 @@ ConsoleIOThread::ThreadShutdown()
 
 	// the job is done, let's wait to be killed..
 	// (avoid to quit and to reach the 'delete this')
-	while (true) {
-		snooze(1000);
-	}
+	while (true)
+		suspend_thread(find_thread(NULL));
 
 	return B_OK;
 }
@@ -234,13 +318,11 @@ ConsoleIOThread::ThreadShutdown()
 void
 ConsoleIOThread::ClosePipes()
 {
-	if (fConsoleOutput)
-		::fclose(fConsoleOutput);
-	if (fConsoleError)
-		::fclose(fConsoleError);
-
-	fConsoleOutput = fConsoleError = nullptr;
+	fOutputOpen = fErrorOpen = false;
+	if (!fPipesOpen)
+		return;
 
+	fPipesOpen = false;
 	fPipeImage.Close();
 }
 
@@ -286,10 +368,10 @@ void
 ConsoleIOThread::_CleanPipes()
 {
 	// pipes are set to non-blocking so we should never be stuck here.
-	while (read(fPipeImage.GetStdOutFD(), fConsoleOutputBuffer, LINE_MAX) > 0) {
+	while (read(fPipeImage.GetStdOutFD(), fReadBuffer, sizeof(fReadBuffer)) > 0) {
 		// loop
 	}
-	while (read(fPipeImage.GetStdErrFD(), fConsoleOutputBuffer, LINE_MAX) > 0) {
+	while (read(fPipeImage.GetStdErrFD(), fReadBuffer, sizeof(fReadBuffer)) > 0) {
 		// loop
 	}
 }
@@ -32,8 +32,6 @@
 #include <Messenger.h>
 #include <String.h>
 
-#include <cstdio>
-
 #include "PipeImage.h"
 
 enum {
@@ -54,6 +52,7 @@ public:
 			bool				IsDone() const { return fIsDone; };
 
 protected:
+	// called with one or more complete lines
 	virtual	void	OnStdOutputLine(const BString& stdOut);
 	virtual void	OnStdErrorLine(const BString& stdErr);
 	virtual void	ThreadExitNotification();
@@ -62,26 +61,39 @@ protected:
 private:
 			void				PushInput(BString text);
 			bool				IsProcessAlive() const;
-			status_t			GetFromPipe(BString& stdOut, BString& stdErr);
+			bool				ReadPipe(int fd, BString& partialLine, BString& lines,
+									size_t& bytes);
+			void				FlushOutput(bool all);
 			void				ClosePipes();
 			status_t			ThreadStartup() override;
 			status_t			ExecuteUnit() override;
 			status_t			ThreadShutdown() override;
 
 			void				_CleanPipes();
+			void				_PostLines(BString& lines, bool error);
 			status_t			_RunExternalProcess();
 
 	virtual status_t			Kill(void);
 
 			thread_id			fExternalProcessId;
-			FILE*				fConsoleOutput;
-			FILE*				fConsoleError;
-			char				fConsoleOutputBuffer[LINE_MAX];
+			bool				fPipesOpen;
+			bool				fOutputOpen;
+			bool				fErrorOpen;
+			char				fReadBuffer[64 * 1024];
 			BString 			fCmdType;
 			bool				fIsDone;
 			bool				fFailed;
+			// the last line read, until its end is read too
 			BString				fLastOutputString;
 			BString				fLastErrorString;
+			// complete lines not posted yet
+			BString				fOutputLines;
+			BString				fErrorLines;
+			bigtime_t			fLastFlush;
+			bigtime_t			fStartTime;
+			int64				fLineCount;
+			int64				fByteCount;
+			int32				fMessageCount;
 			BLocker				fProcessIDLock;
 			PipeImage			fPipeImage;
 };
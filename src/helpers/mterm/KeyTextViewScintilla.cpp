@@ -26,6 +26,9 @@ public:
 
 uint32 kRealModifiers = B_COMMAND_KEY | B_OPTION_KEY | B_CONTROL_KEY | B_MENU_KEY;
 
+// older lines are removed from the top
+static const Sci_Position kMaxScrollbackLines = 20000;
+
 KeyTextViewScintilla::KeyTextViewScintilla(const char *name, const BMessenger &msgr)
     : BScintillaView(name,0,true,true), fTarget(msgr), fEnableInput(false), fCaretPosition(-1)
 {
@@ -71,6 +74,11 @@ KeyTextViewScintilla::Append(const BString& text)
 	bool isRO = SendMessage(SCI_GETREADONLY);
 	if (isRO) SendMessage(SCI_SETREADONLY, false);
 	SendMessage(SCI_APPENDTEXT, text.Length(), (uptr_t)text.String());
+	Sci_Position lines = SendMessage(SCI_GETLINECOUNT);
+	if (lines > kMaxScrollbackLines) {
+		Sci_Position end = SendMessage(SCI_POSITIONFROMLINE, lines - kMaxScrollbackLines);
+		SendMessage(SCI_DELETERANGE, 0, end);
+	}
 	SendMessage(SCI_GOTOPOS, SendMessage(SCI_GETLENGTH));
 	fCaretPosition = SendMessage(SCI_GETCURRENTPOS);
 	if (isRO) SendMessage(SCI_SETREADONLY, true);
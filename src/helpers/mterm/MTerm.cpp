@@ -38,9 +38,14 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <Autolock.h>
 #include <OS.h>
 #include <SupportDefs.h>
 #include "GMessage.h"
+#include "Log.h"
+
+// output not yet taken by the view beyond this size is dropped, oldest first
+static const int32 kMaxPendingOutput = 4 * 1024 * 1024;
 
 /* handshake interface */
 typedef struct
@@ -153,7 +158,15 @@ initialize_termios(struct termios &tio)
 #include <Handler.h>
 using namespace Genio::Task;
 
-MTerm::MTerm(const BMessenger& msgr) : fExecProcessID(-1), fFd(-1), fMessenger(msgr), fReadTask(nullptr)
+MTerm::MTerm(const BMessenger& msgr)
+	:
+	fExecProcessID(-1),
+	fFd(-1),
+	fMessenger(msgr),
+	fReadTask(nullptr),
+	fOutputLock("MTerm output"),
+	fOutputNotified(false),
+	fDroppedBytes(0)
 {
 
 }
@@ -393,13 +406,47 @@ MTerm::_ReadThread()
 		if (nread <= 0) {
 			break;
 		}
-		GMessage msg = {{"what", kMTOutputText },{"text", BString((const char*)buf, nread)}};
-		fMessenger.SendMessage(&msg);
+
+		bool notify = false;
+		{
+			BAutolock lock(fOutputLock);
+			fOutput.Append((const char*)buf, nread);
+			if (fOutput.Length() > kMaxPendingOutput) {
+				// the view is not keeping up: it would drop it from the scrollback anyway
+				int32 excess = fOutput.Length() - kMaxPendingOutput;
+				int32 newLine = fOutput.FindFirst('\n', excess);
+				if (newLine >= 0)
+					excess = newLine + 1;
+				fOutput.Remove(0, excess);
+				fDroppedBytes += excess;
+			}
+			// one notification until the view takes the output
+			notify = !fOutputNotified;
+			fOutputNotified = true;
+		}
+		if (notify) {
+			BMessage msg(kMTOutputText);
+			fMessenger.SendMessage(&msg);
+		}
 	}
 
 	return B_OK;
 }
 
+
+void
+MTerm::TakeOutput(BString& output)
+{
+	BAutolock lock(fOutputLock);
+	output.Truncate(0);
+	output.Adopt(fOutput);
+	fOutputNotified = false;
+	if (fDroppedBytes > 0) {
+		LogInfo("MTerm: %" B_PRIuSIZE " bytes of output dropped", fDroppedBytes);
+		fDroppedBytes = 0;
+	}
+}
+
 void
 MTerm::Write(const void* buffer, size_t size)
 {
@@ -21,13 +21,15 @@
 
 #pragma once
 
+#include <Locker.h>
 #include <Messenger.h>
 #include <OS.h>
+#include <String.h>
 #include <SupportDefs.h>
 
 #include "Task.h"
 
-#define READ_BUF_SIZE 2048
+#define READ_BUF_SIZE 16384
 
 enum MTermMessages {
 	kMTOutputText	=	'ouot',
@@ -45,6 +47,12 @@ public:
 			void Kill(); //exp
 
 			void	Write(const void* buffer, size_t size);
+
+			// Moves the output read so far into 'output'. The reader thread
+			// sends a kMTOutputText message (without text) when output is
+			// available and no other one has been sent since the last call.
+			// Not to be called after Kill().
+			void	TakeOutput(BString& output);
 private:
 			status_t _Spawn(int argc, const char* const* argv);
 			status_t _ReadThread();
@@ -55,6 +63,11 @@ private:
 	int					fFd;
 	BMessenger			fMessenger;
 	Task<status_t>* 	fReadTask;
+
+	BLocker				fOutputLock;
+	BString				fOutput;
+	bool				fOutputNotified;
+	size_t				fDroppedBytes;
 };
 
 
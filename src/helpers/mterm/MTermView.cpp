@@ -11,9 +11,11 @@
 #include <Catalog.h>
 #include <CheckBox.h>
 #include <LayoutBuilder.h>
+#include <MessageRunner.h>
 #include <ScrollView.h>
 #include <String.h>
 #include "KeyTextViewScintilla.h"
+#include "Log.h"
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "TermView"
@@ -22,8 +24,12 @@ enum {
 	kTermViewRun	= 'tvru',
 	kTermViewClear	= 'tvcl',
 	kTermViewStop	= 'tvst',
+	kTermViewFlush	= 'tvfl'
 };
 
+// the output is appended at most once per frame
+static const bigtime_t kOutputInterval = 1000000 / 60;
+
 
 MTermView::MTermView(const BString& name, const BMessenger& target)
 	:
@@ -31,6 +37,11 @@ MTermView::MTermView(const BString& name, const BMessenger& target)
 	, fWindowTarget(target)
 	, fKeyTextView(nullptr)
 	, fMTerm(nullptr)
+	, fOutputScheduled(false)
+	, fLastOutput(0)
+	, fRunStart(0)
+	, fOutputBytes(0)
+	, fOutputFlushes(0)
 {
 	SetName(name);
 	_Init();
@@ -62,8 +73,12 @@ MTermView::MessageReceived(BMessage* message)
 			break;
 		}
 		case kMTOutputText: {
-			BString info = message->GetString("text","");
-			_HandleOutput(info);
+			_ScheduleOutput();
+			break;
+		}
+		case kTermViewFlush: {
+			fOutputScheduled = false;
+			_FlushOutput();
 			break;
 		}
 		case kKTVInputBuffer: {
@@ -85,6 +100,9 @@ MTermView::MessageReceived(BMessage* message)
 			fKeyTextView->EnableInput(true);
 			EnableStopButton(true);
 			fMTerm = new MTerm(BMessenger(this));
+			fRunStart = system_time();
+			fOutputBytes = 0;
+			fOutputFlushes = 0;
 
 			int32 argc = 3;
 			const char** argv = new const char * [argc + 1];
@@ -115,6 +133,10 @@ void
 MTermView::_EnsureStopped()
 {
 	if (fMTerm) {
+		// what was read before the process ended
+		_FlushOutput();
+		LogInfo("MTermView: %" B_PRIuSIZE " bytes appended in %d updates, %" B_PRId64 " ms",
+			fOutputBytes, fOutputFlushes, (system_time() - fRunStart) / 1000);
 		fMTerm->Kill();
 		delete fMTerm;
 		fMTerm = nullptr;
@@ -196,6 +218,42 @@ MTermView::_HandleOutput(const BString& info)
 }
 
 
+void
+MTermView::_ScheduleOutput()
+{
+	if (fOutputScheduled)
+		return;
+
+	const bigtime_t delay = fLastOutput + kOutputInterval - system_time();
+	if (delay <= 0) {
+		_FlushOutput();
+		return;
+	}
+	BMessage flush(kTermViewFlush);
+	if (BMessageRunner::StartSending(BMessenger(this), &flush, delay, 1) == B_OK)
+		fOutputScheduled = true;
+	else
+		_FlushOutput();
+}
+
+
+void
+MTermView::_FlushOutput()
+{
+	if (fMTerm == nullptr)
+		return;
+
+	fMTerm->TakeOutput(fOutputBuffer);
+	if (fOutputBuffer.IsEmpty())
+		return;
+
+	_HandleOutput(fOutputBuffer);
+	fLastOutput = system_time();
+	fOutputBytes += fOutputBuffer.Length();
+	fOutputFlushes++;
+}
+
+
 KeyTextViewScintilla*
 MTermView::TextView()
 {
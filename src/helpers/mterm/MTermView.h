@@ -36,6 +36,8 @@ private:
 			void				EnableStopButton(bool doIt);
 			void				_Init();
 			void				_HandleOutput(const BString& info);
+			void				_ScheduleOutput();
+			void				_FlushOutput();
 			void				_BannerMessage(BString status);
 			void				_EnsureStopped();
 
@@ -45,4 +47,10 @@ private:
 			BButton*					fStopButton;
 			BString						fBannerClaim;
 			MTerm* 						fMTerm;
+			bool						fOutputScheduled;
+			bigtime_t					fLastOutput;
+			BString						fOutputBuffer;
+			bigtime_t					fRunStart;
+			size_t						fOutputBytes;
+			int32						fOutputFlushes;
 };
@@ -16,7 +16,9 @@ enum LSPCapability {
 	kLCapHover                = (1U << 7),
 	kLCapSignatureHelp        = (1U << 8),
 	kLCapRename               = (1U << 9),
-	kLCapDocumentSymbols	  = (1U << 10)
+	kLCapDocumentSymbols	  = (1U << 10),
+	kLCapCodeAction			  = (1U << 11),
+	kLCapWorkspaceFolders	  = (1U << 12)
 };
 
 #define kMsgCapabilitiesUpdated 'CaUp'
@@ -14,10 +14,15 @@
 #include <algorithm>
 #include <cstdio>
 #include <debugger.h>
+#include <iterator>
+#include <string>
 #include <unistd.h>
+#include <unordered_map>
 
 #include "Editor.h"
+#include "EditorMessages.h"
 #include "Log.h"
+#include "LSPMessage.h"
 #include "LSPProjectWrapper.h"
 #include "protocol.h"
 #include "TextUtils.h"
@@ -29,6 +34,11 @@
 #define IND_DIAG INDICATOR_CONTAINER + 1 //Style for Problems
 #define IND_LINK INDICATOR_CONTAINER + 2 //Style for Links
 
+// rough size of the json describing the range of a change event
+const size_t kChangeEventOverhead = 96;
+const bigtime_t kMinChangesDelay = 50000;
+const bigtime_t kMaxChangesLatency = 2000000;
+
 LSPEditorWrapper::LSPEditorWrapper(BPath filenamePath, Editor* editor)
 	:
 	LSPTextDocument(filenamePath, editor->FileType().c_str()),
@@ -36,7 +46,17 @@ LSPEditorWrapper::LSPEditorWrapper(BPath filenamePath, Editor* editor)
 	fToolTip(nullptr),
 	fLSPProjectWrapper(nullptr),
 	fCallTip(editor),
-	fInitialized(false)
+	fInitialized(false),
+	fOpened(false),
+	fActive(false),
+	fCompletionStart(0),
+	fLastChangeStart(0),
+	fPendingBytes(0),
+	fFirstChangeTime(0),
+	fFullSyncPending(false),
+	fDocumentVersion(0),
+	fLinksVersion(-1),
+	fLineIndex(SC_LINECHARACTERINDEX_NONE)
 {
 	assert(fEditor);
 }
@@ -73,6 +93,9 @@ LSPEditorWrapper::UnsetLSPServer()
 	fFileStatus = "";
 	fLSPProjectWrapper->UnregisterTextDocument(this);
 	fLSPProjectWrapper = nullptr;
+	// a new server has to be initialized first
+	fInitialized = false;
+	_SetPositionEncoding(OffsetEncoding::UTF8);
 }
 
 
@@ -151,19 +174,43 @@ LSPEditorWrapper::SetLSPServer(LSPProjectWrapper* cW) {
 bool
 LSPEditorWrapper::IsInitialized()
 {
-	return (fInitialized && fLSPProjectWrapper != nullptr);
+	// nothing is sent for a document not opened on the server
+	return (fInitialized && fOpened && fLSPProjectWrapper != nullptr);
+}
+
+
+void
+LSPEditorWrapper::Activate()
+{
+	fActive = true;
+	if (fOpened) {
+		if (fLSPProjectWrapper != nullptr)
+			fLSPProjectWrapper->DocumentUsed(this);
+		return;
+	}
+	didOpen();
+}
+
+
+void
+LSPEditorWrapper::CloseIdle()
+{
+	didClose();
+	fActive = false;
 }
 
 
 void
 LSPEditorWrapper::didOpen()
 {
-	if (!IsInitialized())
+	if (!fInitialized || fOpened || fLSPProjectWrapper == nullptr)
 		return;
 
 	const char* text = (const char*) fEditor->SendMessage(SCI_GETCHARACTERPOINTER);
 
 	fLSPProjectWrapper->DidOpen(this, text, FileType().String());
+	fOpened = true;
+	fLSPProjectWrapper->DocumentUsed(this);
 	// fLSPProjectWrapper->Sync();
 }
 
@@ -179,7 +226,14 @@ LSPEditorWrapper::didClose()
 		_RemoveAllDocumentLinks();
 	}
 
+	fChanges.clear();
+	fPendingBytes = 0;
+	fFullSyncPending = false;
+	fLinksVersion = -1;
+
 	fLSPProjectWrapper->DidClose(this);
+	fOpened = false;
+	fLSPProjectWrapper->DocumentClosed(this);
 }
 
 
@@ -201,27 +255,119 @@ LSPEditorWrapper::didChange(
 	if (!IsInitialized() || !fEditor)
 		return;
 
-	Sci_Position end_pos = fEditor->SendMessage(SCI_POSITIONRELATIVE, start_pos, poslength);
+	// the whole document will be sent on flush, no need to track the edits
+	if (fFullSyncPending)
+		return;
+
+	if (fChanges.empty())
+		fFirstChangeTime = system_time();
+
+	if (_MergeChange(text, len, start_pos, poslength))
+		return;
+
+	// the deleted length from SCN_MODIFIED is in bytes, as Scintilla positions
+	Sci_Position end_pos = start_pos + poslength;
 
 	TextDocumentContentChangeEvent event;
 	Range range;
-	FromSciPositionToLSPPosition(start_pos, &range.start);
-	FromSciPositionToLSPPosition(end_pos, &range.end);
+	FromSciPositionToRange(start_pos, end_pos, &range);
 
 	event.range = range;
 	event.text.assign(text, len);
 
+	fPendingBytes += len + kChangeEventOverhead;
 	fChanges.push_back(event);
+	fLastChangeStart = start_pos;
+
+	if (fPendingBytes > (size_t)fEditor->SendMessage(SCI_GETLENGTH)) {
+		fChanges.clear();
+		fFullSyncPending = true;
+	}
+}
+
+
+bool
+LSPEditorWrapper::_MergeChange(const char* text, long len, Sci_Position start,
+	Sci_Position length)
+{
+	// Only the last event can be extended: its text is the current content
+	// of the document between fLastChangeStart and lastEnd, while its range
+	// still refers to the document before the event.
+	if (fChanges.empty() || !fChanges.back().range)
+		return false;
+
+	TextDocumentContentChangeEvent& last = fChanges.back();
+	const Sci_Position lastEnd = fLastChangeStart + last.text.length();
+
+	if (length == 0) {
+		// typing inside or right after the last inserted text
+		if (start < fLastChangeStart || start > lastEnd)
+			return false;
+		last.text.insert(start - fLastChangeStart, text, len);
+		fPendingBytes += len;
+		return true;
+	}
+
+	if (len != 0)
+		return false;
+
+	if (start >= fLastChangeStart && start + length <= lastEnd) {
+		// deleting part of the last inserted text
+		last.text.erase(start - fLastChangeStart, length);
+		return true;
+	}
+
+	if (start < fLastChangeStart && start + length == lastEnd) {
+		// backspacing over the last inserted text and beyond: the text
+		// before fLastChangeStart is still the original one.
+		FromSciPositionToLSPPosition(start, &last.range->start);
+		last.text.clear();
+		fLastChangeStart = start;
+		return true;
+	}
+
+	return false;
 }
 
 
 void
 LSPEditorWrapper::flushChanges()
 {
+	if (fFullSyncPending) {
+		fFullSyncPending = false;
+		if (IsInitialized()) {
+			// the edits are bigger than the document itself, let's send it all
+			TextDocumentContentChangeEvent event;
+			event.text.assign((const char*)fEditor->SendMessage(SCI_GETCHARACTERPOINTER),
+				fEditor->SendMessage(SCI_GETLENGTH));
+			fChanges.clear();
+			fChanges.push_back(std::move(event));
+		}
+	}
+
 	if (fChanges.size() > 0) {
 		fLSPProjectWrapper->DidChange(this, fChanges, false);
 		fChanges.clear();
+		fDocumentVersion++;
 	}
+	fPendingBytes = 0;
+}
+
+
+bigtime_t
+LSPEditorWrapper::FlushDelay(bigtime_t idleTime)
+{
+	// Keep postponing the flush while the user is typing, but never hold
+	// the edits longer than kMaxChangesLatency: the server would be late
+	// with diagnostics. A pending full sync is sent as soon as possible.
+	if (fFullSyncPending)
+		return kMinChangesDelay;
+
+	if (fChanges.empty())
+		return idleTime;
+
+	bigtime_t remaining = fFirstChangeTime + kMaxChangesLatency - system_time();
+	return std::max(kMinChangesDelay, std::min(idleTime, remaining));
 }
 
 
@@ -322,7 +468,10 @@ LSPEditorWrapper::StartHover(Sci_Position sci_position)
 	}
 
 	LSPDiagnostic dia;
-	if (DiagnosticFromPosition(sci_position, dia) > -1) {
+	int32 index = DiagnosticFromPosition(sci_position, dia);
+	if (index > -1) {
+		// the fixes are ready if the user asks for them
+		RequestCodeActions(index);
 		_ShowToolTip(dia.range.info.c_str());
 		return;
 	}
@@ -361,7 +510,7 @@ LSPEditorWrapper::DiagnosticFromRange(Range& range, LSPDiagnostic& dia)
 			return index;
 		}
 	}
-	return index;
+	return -1;
 }
 
 
@@ -455,17 +604,48 @@ LSPEditorWrapper::StartCompletion()
 	if (!IsInitialized() || !fEditor || !IsStatusValid())
 		return;
 
+	// the list shown is complete: no need to ask the server again
+	std::string prefix;
+	if (fEditor->SendMessage(SCI_AUTOCACTIVE) && !fCurrentCompletion.items.empty()
+		&& !fCurrentCompletion.isIncomplete && _CompletionPrefix(prefix)) {
+		_ShowCompletion();
+		return;
+	}
+
 	// let's check if a completion is ongoing
 	if (fCurrentCompletion.items.size() > 0) {
 		// let's close the current Scintilla listbox
 		fEditor->SendMessage(SCI_AUTOCCANCEL, 0, 0);
-		// let's cancel any previous request running on clangd
-		// --> TODO: cancel previous clangd request!
+		// any previous request still running on the server is cancelled
+		// by LSPProjectWrapper when the new one is sent.
 
 		// let's clean-up current request details:
 		this->fCurrentCompletion = CompletionList();
 	}
 
+	_RequestCompletion();
+}
+
+
+void
+LSPEditorWrapper::UpdateCompletion()
+{
+	if (!IsInitialized() || !fEditor || fCurrentCompletion.items.empty())
+		return;
+
+	// the old list is filtered until the new one arrives
+	_ShowCompletion();
+	std::string prefix;
+	if (fCurrentCompletion.isIncomplete && _CompletionPrefix(prefix) && IsStatusValid()) {
+		flushChanges();
+		_RequestCompletion();
+	}
+}
+
+
+void
+LSPEditorWrapper::_RequestCompletion()
+{
 	Position position;
 	GetCurrentLSPPosition(&position);
 	CompletionContext context;
@@ -475,6 +655,81 @@ LSPEditorWrapper::StartCompletion()
 }
 
 
+bool
+LSPEditorWrapper::_CompletionPrefix(std::string& prefix)
+{
+	// the list is valid while typing the same word
+	const Sci_Position pos = fEditor->SendMessage(SCI_GETCURRENTPOS);
+	if (pos < fCompletionStart
+		|| fEditor->SendMessage(SCI_LINEFROMPOSITION, pos)
+			!= fEditor->SendMessage(SCI_LINEFROMPOSITION, fCompletionStart)) {
+		return false;
+	}
+
+	const char* text = (const char*)fEditor->SendMessage(SCI_GETRANGEPOINTER,
+		fCompletionStart, pos - fCompletionStart);
+	prefix.assign(text != nullptr ? text : "", text != nullptr ? pos - fCompletionStart : 0);
+	return true;
+}
+
+
+void
+LSPEditorWrapper::_ShowCompletion()
+{
+	std::string prefix;
+	if (!_CompletionPrefix(prefix)) {
+		fEditor->SendMessage(SCI_AUTOCCANCEL);
+		return;
+	}
+
+	const bigtime_t start = system_time();
+	const std::vector<CompletionItem>& items = fCurrentCompletion.items;
+
+	// score, index of the item
+	std::vector<std::pair<int, size_t>> matches;
+	matches.reserve(items.size());
+	for (size_t i = 0; i < items.size(); i++) {
+		const CompletionItem& item = items[i];
+		const int score = FuzzyScore(prefix,
+			item.filterText.empty() ? item.label : item.filterText);
+		if (score >= 0)
+			matches.push_back(std::make_pair(score, i));
+	}
+	if (matches.empty()) {
+		fEditor->SendMessage(SCI_AUTOCCANCEL);
+		return;
+	}
+
+	// the best matches first, then as sorted by the server
+	std::stable_sort(matches.begin(), matches.end(),
+		[&items](const std::pair<int, size_t>& a, const std::pair<int, size_t>& b) {
+			if (a.first != b.first)
+				return a.first > b.first;
+			return items[a.second].sortText < items[b.second].sortText;
+		});
+
+	std::string list;
+	for (const auto& match : matches) {
+		if (list.length() > 0)
+			list += "\n";
+		list += items[match.second].label;
+	}
+
+	fEditor->SendMessage(SCI_AUTOCSETSEPARATOR, (int) '\n', 0);
+	fEditor->SendMessage(SCI_AUTOCSETIGNORECASE, true);
+	fEditor->SendMessage(SCI_AUTOCSETCANCELATSTART, false);
+	// the list is already filtered and sorted: Scintilla must not move
+	// the selection to its own prefix match, nor hide the list
+	fEditor->SendMessage(SCI_AUTOCSETAUTOHIDE, false);
+	fEditor->SendMessage(SCI_AUTOCSETOPTIONS, SC_AUTOCOMPLETE_SELECT_FIRST_ITEM);
+	fEditor->SendMessage(SCI_AUTOCSETORDER, SC_ORDER_CUSTOM, 0);
+	fEditor->SendMessage(SCI_AUTOCSHOW, prefix.length(), (sptr_t) list.c_str());
+
+	LogTrace("Completion: %d of %d items match [%s] in %" B_PRId64 " us",
+		(int32)matches.size(), (int32)items.size(), prefix.c_str(), system_time() - start);
+}
+
+
 void
 LSPEditorWrapper::NextCallTip()
 {
@@ -492,7 +747,7 @@ LSPEditorWrapper::PrevCallTip()
 void
 LSPEditorWrapper::RequestDocumentSymbols()
 {
-	if (fLSPProjectWrapper == nullptr || fEditor == nullptr)
+	if (!IsInitialized() || fEditor == nullptr)
 		return;
 
 	fLSPProjectWrapper->DocumentSymbol(this);
@@ -520,6 +775,8 @@ LSPEditorWrapper::CharAdded(const char ch /*utf-8?*/)
 
 			flushChanges();
 			StartCompletion();
+		} else if (Contains(kWordCharacters, ch) && fEditor->SendMessage(SCI_AUTOCACTIVE)) {
+			UpdateCompletion();
 		}
 	}
 
@@ -634,30 +891,30 @@ LSPEditorWrapper::_DoSwitchSourceHeader(json& result)
 
 
 void
-LSPEditorWrapper::_DoCompletion(json& params)
+LSPEditorWrapper::_DoCompletion(CompletionList& allItems)
 {
+	auto& items = allItems.items;
+	if (items.empty()) {
+		// nothing left while refreshing an incomplete list
+		fCurrentCompletion = CompletionList();
+		fEditor->SendMessage(SCI_AUTOCCANCEL);
+		return;
+	}
+
 	std::string line;
 	Position position;
 	position.character = -1;
 
-	CompletionList allItems = params.get<CompletionList>();
-	auto& items = allItems.items;
-	std::string list;
+	Position end;
+	FromSciPositionToLSPPosition(fCompletionPosition, &end);
+
 	for (auto& item : items) {
-		std::string label = item.label;
-		LeftTrim(label);
-		if (list.length() > 0)
-			list += "\n";
-		list += label;
-		item.label = label;
+		LeftTrim(item.label);
 		// if the server is not providing us the textEdit (like pylsp)
 		// let's try to create it.
 		if (item.textEdit.newText.empty()) {
 			item.textEdit.newText = item.insertText;
-
-			Position pos;
-			FromSciPositionToLSPPosition(fCompletionPosition, &pos);
-			item.textEdit.range.end = pos;
+			item.textEdit.range.end = end;
 
 			// fancy algo to find insertText before current position.
 			if (position.character == -1) {
@@ -674,27 +931,18 @@ LSPEditorWrapper::_DoCompletion(json& params)
 					}
 				}
 			}
-			FromSciPositionToLSPPosition(fCompletionPosition - points, &pos);
-			item.textEdit.range.start = pos;
-
+			FromSciPositionToLSPPosition(fCompletionPosition - points, &item.textEdit.range.start);
 		}
 	}
 
-	if (list.length() > 0) {
-		fCurrentCompletion = allItems;
-		fEditor->SendMessage(SCI_AUTOCSETSEPARATOR, (int) '\n', 0);
-		fEditor->SendMessage(SCI_AUTOCSETIGNORECASE, true);
-		fEditor->SendMessage(SCI_AUTOCGETCANCELATSTART, false);
-		fEditor->SendMessage(SCI_AUTOCSETORDER, SC_ORDER_CUSTOM, 0);
-
-		// whats' the text already selected so far?
-		const Position start = fCurrentCompletion.items[0].textEdit.range.start;
-		const Sci_Position s_pos = FromLSPPositionToSciPosition(&start);
-		Sci_Position len = fCompletionPosition - s_pos;
-		if (len < 0)
-			len = 0;
-		fEditor->SendMessage(SCI_AUTOCSHOW, len, (sptr_t) list.c_str());
-	}
+	fCurrentCompletion = std::move(allItems);
+
+	// whats' the text already selected so far?
+	const Position start = fCurrentCompletion.items[0].textEdit.range.start;
+	fCompletionStart = std::min(FromLSPPositionToSciPosition(&start), fCompletionPosition);
+
+	// the text typed while waiting for the server filters the list
+	_ShowCompletion();
 }
 
 
@@ -708,46 +956,81 @@ LSPEditorWrapper::_RemoveAllDiagnostics()
 }
 
 
-void
-LSPEditorWrapper::_DoDiagnostics(nlohmann::json& params)
+/* static */
+std::string
+LSPEditorWrapper::DiagnosticKey(const Diagnostic& diagnostic)
 {
-	auto vect = params["diagnostics"].get<std::vector<Diagnostic>>();
+	const Range& range = diagnostic.range;
+	std::string key;
+	key.append(std::to_string(range.start.line)).append(":")
+		.append(std::to_string(range.start.character)).append("-")
+		.append(std::to_string(range.end.line)).append(":")
+		.append(std::to_string(range.end.character)).append(" ")
+		.append(std::to_string(diagnostic.severity)).append(" ")
+		.append(diagnostic.category.value()).append(" ")
+		.append(diagnostic.source).append(" ")
+		.append(diagnostic.message);
+	return key;
+}
 
-	_RemoveAllDiagnostics();
 
-	for (auto& v : vect) {
+void
+LSPEditorWrapper::_DoDiagnostics(std::vector<Diagnostic>& vect)
+{
+	// the fixes already received for a problem still there are kept
+	std::unordered_map<std::string, size_t> previous;
+	for (size_t i = 0; i < fLastDiagnostics.size(); i++)
+		previous.emplace(DiagnosticKey(fLastDiagnostics[i].diagnostic), i);
+
+	std::vector<Range> ranges;
+	ranges.reserve(vect.size());
+	for (auto& v : vect)
+		ranges.push_back(v.range);
+	std::vector<InfoRange> sciRanges;
+	FromLSPRangesToSciRanges(ranges, sciRanges);
+
+	std::vector<LSPDiagnostic> diagnostics;
+	diagnostics.reserve(vect.size());
+	for (size_t i = 0; i < vect.size(); i++) {
+		Diagnostic& v = vect[i];
 		LSPDiagnostic lspDiag;
 
-		Range& r = v.range;
 		InfoRange& ir = lspDiag.range;
-		ir.from = FromLSPPositionToSciPosition(&r.start);
-		ir.to = FromLSPPositionToSciPosition(&r.end);
+		ir.from = sciRanges[i].from;
+		ir.to = sciRanges[i].to;
 		ir.info = v.message;
 
 		lspDiag.diagnostic = v;
 
-		LogTrace("Diagnostics [%ld->%ld] [%s]", ir.from, ir.to, ir.info.c_str());
-		fEditor->SendMessage(SCI_INDICATORFILLRANGE, ir.from, ir.to - ir.from);
-
 		// dia["be:line"] = v.range.start.line + 1;
 		// dia["lsp:character"] = v.range.start.character;
 
+		// if the language server does not support in-line code actions they
+		// are requested when the diagnostic is hovered or selected
 		if (v.codeActions.value().size() == 0) {
-			// if the language serve does not support in-line code actions we request them
-			// asyncronously
-			// TODO: Check the capability
-			RequestCodeActions(v);
+			auto found = previous.find(DiagnosticKey(v));
+			if (found != previous.end()) {
+				LSPDiagnostic& old = fLastDiagnostics[found->second];
+				lspDiag.diagnostic.codeActions = old.diagnostic.codeActions;
+				lspDiag.codeActionsRequested = old.codeActionsRequested;
+			}
 		}
 
-		fLastDiagnostics.push_back(lspDiag);
+		LogTrace("Diagnostics [%ld->%ld] [%s]", ir.from, ir.to, ir.info.c_str());
+		diagnostics.push_back(std::move(lspDiag));
 	}
+	fLastDiagnostics = std::move(diagnostics);
+
+	_UpdateDiagnosticIndicators();
 
 	if (fEditor->LockLooper()) {
 		fEditor->SetProblems();
 		fEditor->UnlockLooper();
 	}
 
-	if (fLSPProjectWrapper) {
+	// links and symbols only change with the text
+	if (fLSPProjectWrapper && fLinksVersion != fDocumentVersion) {
+		fLinksVersion = fDocumentVersion;
 		fLSPProjectWrapper->DocumentLink(this);
 		fLSPProjectWrapper->DocumentSymbol(this);
 	}
@@ -755,11 +1038,74 @@ LSPEditorWrapper::_DoDiagnostics(nlohmann::json& params)
 
 
 void
-LSPEditorWrapper::RequestCodeActions(Diagnostic& diagnostic)
+LSPEditorWrapper::_UpdateDiagnosticIndicators()
+{
+	typedef std::pair<Sci_Position, Sci_Position> IndicatorRange;
+
+	// the ranges to be marked, merged as Scintilla does
+	std::vector<IndicatorRange> wanted;
+	wanted.reserve(fLastDiagnostics.size());
+	for (auto& d : fLastDiagnostics) {
+		if (d.range.to > d.range.from)
+			wanted.push_back(IndicatorRange(d.range.from, d.range.to));
+	}
+	std::sort(wanted.begin(), wanted.end());
+	std::vector<IndicatorRange> merged;
+	for (auto& range : wanted) {
+		if (!merged.empty() && range.first <= merged.back().second)
+			merged.back().second = std::max(merged.back().second, range.second);
+		else
+			merged.push_back(range);
+	}
+
+	// the ranges marked now, moved by Scintilla along with the text
+	std::vector<IndicatorRange> current;
+	const Sci_Position length = fEditor->SendMessage(SCI_GETLENGTH);
+	Sci_Position position = 0;
+	while (position < length) {
+		const Sci_Position end = fEditor->SendMessage(SCI_INDICATOREND, IND_DIAG, position);
+		if (end <= position)
+			break;
+		if (fEditor->SendMessage(SCI_INDICATORVALUEAT, IND_DIAG, position) != 0)
+			current.push_back(IndicatorRange(position, end));
+		position = end;
+	}
+
+	std::vector<IndicatorRange> stale;
+	std::set_difference(current.begin(), current.end(), merged.begin(), merged.end(),
+		std::back_inserter(stale));
+	std::vector<IndicatorRange> missing;
+	std::set_difference(merged.begin(), merged.end(), current.begin(), current.end(),
+		std::back_inserter(missing));
+
+	fEditor->SendMessage(SCI_SETINDICATORCURRENT, IND_DIAG);
+	for (auto& range : stale)
+		fEditor->SendMessage(SCI_INDICATORCLEARRANGE, range.first, range.second - range.first);
+	for (auto& range : missing)
+		fEditor->SendMessage(SCI_INDICATORFILLRANGE, range.first, range.second - range.first);
+
+	LogTrace("Diagnostics: %d ranges, %d cleared, %d filled", (int32)merged.size(),
+		(int32)stale.size(), (int32)missing.size());
+}
+
+
+bool
+LSPEditorWrapper::RequestCodeActions(int32 index)
 {
+	if (index < 0 || (size_t)index >= fLastDiagnostics.size()
+		|| !HasLSPServerCapability(kLCapCodeAction)) {
+		return false;
+	}
+
+	LSPDiagnostic& dia = fLastDiagnostics[index];
+	if (dia.codeActionsRequested || dia.diagnostic.codeActions.value().size() > 0)
+		return false;
+	dia.codeActionsRequested = true;
+
 	CodeActionContext context;
-	context.diagnostics.push_back(std::move(diagnostic));
-	fLSPProjectWrapper->CodeAction(this, diagnostic.range, context);
+	context.diagnostics.push_back(dia.diagnostic);
+	fLSPProjectWrapper->CodeAction(this, dia.diagnostic.range, context);
+	return true;
 }
 
 
@@ -797,6 +1143,9 @@ LSPEditorWrapper::_DoCodeActions(nlohmann::json& params)
 			}
 		}
 	}
+	// a context menu may be waiting for them
+	if (fEditor != nullptr)
+		BMessenger(fEditor).SendMessage(kCodeActionsReceived);
 }
 
 
@@ -845,7 +1194,10 @@ void
 LSPEditorWrapper::_DoInitialize(nlohmann::json& params)
 {
 	fInitialized = true;
-	didOpen();
+	_SetPositionEncoding(fLSPProjectWrapper->PositionEncoding());
+	// background tabs are opened when shown
+	if (fActive)
+		didOpen();
 	BMessage symbols;
 	if (HasLSPServerCapability(kLCapDocumentSymbols))
 		fEditor->SetDocumentSymbols(&symbols, Editor::STATUS_REQUESTED);
@@ -861,14 +1213,18 @@ LSPEditorWrapper::_DoDocumentLink(nlohmann::json& result)
 
 	_RemoveAllDocumentLinks();
 
-	for (auto& l : links) {
-		Range& r = l.range;
-		InfoRange ir;
-		ir.from = FromLSPPositionToSciPosition(&r.start);
-		ir.to = FromLSPPositionToSciPosition(&r.end);
-		ir.info = l.target;
+	std::vector<Range> ranges;
+	ranges.reserve(links.size());
+	for (auto& l : links)
+		ranges.push_back(l.range);
+	std::vector<InfoRange> sciRanges;
+	FromLSPRangesToSciRanges(ranges, sciRanges);
+
+	for (size_t i = 0; i < links.size(); i++) {
+		InfoRange& ir = sciRanges[i];
+		ir.info = links[i].target;
 
-		LogTrace("DocumentLink [%ld->%ld] [%s]", ir.from, ir.to, l.target.c_str());
+		LogTrace("DocumentLink [%ld->%ld] [%s]", ir.from, ir.to, ir.info.c_str());
 		fEditor->SendMessage(SCI_INDICATORFILLRANGE, ir.from, ir.to - ir.from);
 		fLastDocumentLinks.push_back(ir);
 	}
@@ -885,18 +1241,13 @@ LSPEditorWrapper::_DoFileStatus(nlohmann::json& params)
 
 
 void
-LSPEditorWrapper::_DoDocumentSymbol(nlohmann::json& params)
+LSPEditorWrapper::_DoDocumentSymbol(LSPMessage& message)
 {
 	BMessage msg(EDITOR_UPDATE_SYMBOLS);
-	if (params.is_array() && params.size() > 0) {
-		if (params[0]["location"].is_null()) {
-			auto vect = params.get<std::vector<DocumentSymbol>>();
-			_DoRecursiveDocumentSymbol(vect, msg);
-		} else {
-			auto vect = params.get<std::vector<SymbolInformation>>();
-			_DoLinearSymbolInformation(vect, msg);
-		}
-	}
+	if (message.symbols.size() > 0)
+		_DoRecursiveDocumentSymbol(message.symbols, msg);
+	else if (message.symbolInformation.size() > 0)
+		_DoLinearSymbolInformation(message.symbolInformation, msg);
 	if (fEditor != nullptr)
 		fEditor->SetDocumentSymbols(&msg, Editor::STATUS_HAS_SYMBOLS);
 }
@@ -954,7 +1305,6 @@ LSPEditorWrapper::IsStatusValid()
 void
 LSPEditorWrapper::onNotify(std::string id, value& result)
 {
-	IF_ID("textDocument/publishDiagnostics", _DoDiagnostics);
 	IF_ID("textDocument/clangd.fileStatus", _DoFileStatus);
 
 	LogError("LSPEditorWrapper::onNotify not handled! [%s]", id.c_str());
@@ -973,9 +1323,7 @@ LSPEditorWrapper::onResponse(RequestID id, value& result)
 	IF_ID("textDocument/implementation", _DoGoTo);
 	IF_ID("textDocument/signatureHelp", _DoSignatureHelp);
 	IF_ID("textDocument/switchSourceHeader", _DoSwitchSourceHeader);
-	IF_ID("textDocument/completion", _DoCompletion);
 	IF_ID("textDocument/documentLink", _DoDocumentLink);
-	IF_ID("textDocument/documentSymbol", _DoDocumentSymbol);
 	IF_ID("initialize", _DoInitialize);
 	IF_ID("textDocument/codeAction", _DoCodeActions);
 	IF_ID("codeAction/resolve", _DoCodeActionResolve);
@@ -984,6 +1332,34 @@ LSPEditorWrapper::onResponse(RequestID id, value& result)
 }
 
 
+void
+LSPEditorWrapper::onDecodedNotify(std::string id, LSPMessage& message)
+{
+	if (id.compare("textDocument/publishDiagnostics") == 0) {
+		_DoDiagnostics(message.diagnostics);
+		return;
+	}
+
+	LogError("LSPEditorWrapper::onDecodedNotify not handled! [%s]", id.c_str());
+}
+
+
+void
+LSPEditorWrapper::onDecodedResponse(RequestID id, LSPMessage& message)
+{
+	if (id.compare("textDocument/completion") == 0) {
+		_DoCompletion(message.completion);
+		return;
+	}
+	if (id.compare("textDocument/documentSymbol") == 0) {
+		_DoDocumentSymbol(message);
+		return;
+	}
+
+	LogError("LSPEditorWrapper::onDecodedResponse not handled! [%s]", id.c_str());
+}
+
+
 void
 LSPEditorWrapper::onError(RequestID id, value& error)
 {
@@ -1000,26 +1376,126 @@ LSPEditorWrapper::onRequest(std::string method, value& params, value& ID)
 
 
 // utility
+void
+LSPEditorWrapper::_SetPositionEncoding(OffsetEncoding encoding)
+{
+	int32 lineIndex = SC_LINECHARACTERINDEX_NONE;
+	if (encoding == OffsetEncoding::UTF16)
+		lineIndex = SC_LINECHARACTERINDEX_UTF16;
+	else if (encoding == OffsetEncoding::UTF32)
+		lineIndex = SC_LINECHARACTERINDEX_UTF32;
+
+	if (lineIndex == fLineIndex)
+		return;
+
+	// the indexes are reference counted by Scintilla
+	if (fLineIndex != SC_LINECHARACTERINDEX_NONE)
+		fEditor->SendMessage(SCI_RELEASELINECHARACTERINDEX, fLineIndex);
+	fLineIndex = lineIndex;
+	if (fLineIndex != SC_LINECHARACTERINDEX_NONE)
+		fEditor->SendMessage(SCI_ALLOCATELINECHARACTERINDEX, fLineIndex);
+}
+
+
+void
+LSPEditorWrapper::_GetLineInfo(Sci_Position line, LineInfo& info)
+{
+	if (info.line == line)
+		return;
+
+	info.line = line;
+	info.start = fEditor->SendMessage(SCI_POSITIONFROMLINE, line);
+	info.end = fEditor->SendMessage(SCI_GETLINEENDPOSITION, line);
+	info.singleByte = true;
+	if (fLineIndex != SC_LINECHARACTERINDEX_NONE) {
+		// a multi byte character is always fewer code units than bytes
+		const Sci_Position bytes = fEditor->SendMessage(SCI_POSITIONFROMLINE, line + 1)
+			- info.start;
+		const Sci_Position units
+			= fEditor->SendMessage(SCI_INDEXPOSITIONFROMLINE, line + 1, fLineIndex)
+			- fEditor->SendMessage(SCI_INDEXPOSITIONFROMLINE, line, fLineIndex);
+		info.singleByte = (units == bytes);
+	}
+}
+
+
 void
 LSPEditorWrapper::FromSciPositionToLSPPosition(const Sci_Position& pos, Position* lsp_position)
 {
-	lsp_position->line = fEditor->SendMessage(SCI_LINEFROMPOSITION, pos, 0);
-	Sci_Position end_pos = fEditor->SendMessage(SCI_POSITIONFROMLINE, lsp_position->line, 0);
-	lsp_position->character = fEditor->SendMessage(SCI_COUNTCHARACTERS, end_pos, pos);
+	LineInfo cache;
+	FromSciPositionToLSPPosition(pos, lsp_position, cache);
+}
+
+
+void
+LSPEditorWrapper::FromSciPositionToLSPPosition(const Sci_Position& pos, Position* lsp_position,
+	LineInfo& cache)
+{
+	const Sci_Position line = fEditor->SendMessage(SCI_LINEFROMPOSITION, pos, 0);
+	_GetLineInfo(line, cache);
+
+	lsp_position->line = line;
+	if (cache.singleByte)
+		lsp_position->character = pos - cache.start;
+	else if (fLineIndex == SC_LINECHARACTERINDEX_UTF16)
+		lsp_position->character = fEditor->SendMessage(SCI_COUNTCODEUNITS, cache.start, pos);
+	else
+		lsp_position->character = fEditor->SendMessage(SCI_COUNTCHARACTERS, cache.start, pos);
 }
 
 
 Sci_Position
 LSPEditorWrapper::FromLSPPositionToSciPosition(const Position* lsp_position)
 {
+	LineInfo cache;
+	return FromLSPPositionToSciPosition(lsp_position, cache);
+}
+
+
+Sci_Position
+LSPEditorWrapper::FromLSPPositionToSciPosition(const Position* lsp_position, LineInfo& cache)
+{
+	if (lsp_position->line < 0)
+		return 0;
+	if (lsp_position->line >= fEditor->SendMessage(SCI_GETLINECOUNT))
+		return fEditor->SendMessage(SCI_GETLENGTH);
+
+	_GetLineInfo(lsp_position->line, cache);
+
+	// a character past the end of the line means the end of the line
+	if (cache.singleByte)
+		return std::min(cache.start + lsp_position->character, cache.end);
+
 	Sci_Position sci_position;
-	sci_position = fEditor->SendMessage(SCI_POSITIONFROMLINE, lsp_position->line, 0);
-	sci_position
-		= fEditor->SendMessage(SCI_POSITIONRELATIVE, sci_position, lsp_position->character);
+	if (fLineIndex == SC_LINECHARACTERINDEX_UTF16) {
+		sci_position = fEditor->SendMessage(SCI_POSITIONRELATIVECODEUNITS, cache.start,
+			lsp_position->character);
+	} else {
+		sci_position = fEditor->SendMessage(SCI_POSITIONRELATIVE, cache.start,
+			lsp_position->character);
+	}
+	// Scintilla returns 0 past the end of the document
+	if (sci_position > cache.end || (sci_position <= cache.start && lsp_position->character > 0))
+		sci_position = cache.end;
 	return sci_position;
 }
 
 
+void
+LSPEditorWrapper::FromLSPRangesToSciRanges(const std::vector<Range>& ranges,
+	std::vector<InfoRange>& sciRanges)
+{
+	// the ranges are usually sorted, so most of them reuse the line
+	// of the previous conversion
+	LineInfo cache;
+	sciRanges.resize(ranges.size());
+	for (size_t i = 0; i < ranges.size(); i++) {
+		sciRanges[i].from = FromLSPPositionToSciPosition(&ranges[i].start, cache);
+		sciRanges[i].to = FromLSPPositionToSciPosition(&ranges[i].end, cache);
+	}
+}
+
+
 void
 LSPEditorWrapper::GetCurrentLSPPosition(Position* lsp_position)
 {
@@ -1031,8 +1507,9 @@ LSPEditorWrapper::GetCurrentLSPPosition(Position* lsp_position)
 void
 LSPEditorWrapper::FromSciPositionToRange(Sci_Position s_start, Sci_Position s_end, Range* range)
 {
-	FromSciPositionToLSPPosition(s_start, &range->start);
-	FromSciPositionToLSPPosition(s_end, &range->end);
+	LineInfo cache;
+	FromSciPositionToLSPPosition(s_start, &range->start, cache);
+	FromSciPositionToLSPPosition(s_end, &range->end, cache);
 }
 
 
@@ -27,6 +27,7 @@ struct LSPDiagnostic {
 	InfoRange range;
 	Diagnostic diagnostic;
 	std::string fixTitle;
+	bool codeActionsRequested = false;
 };
 
 class LSPProjectWrapper;
@@ -50,15 +51,24 @@ public:
 		void 	ApplyEdit(std::string info);
 		void	GoTo(LSPEditorWrapper::GoToType type);
 
+		// The document is shown or navigated to: it's opened on the server
+		// (didOpen) only from now on.
+		void	Activate();
+		void	CloseIdle();
+
 private:
 		void	didOpen();
 public:
 		void	didClose();
 		void	didChange(const char* text, long len, Sci_Position start_pos, Sci_Position poslength);
 		void	flushChanges();
+		bigtime_t	FlushDelay(bigtime_t idleTime);
 		void	didSave();
 
 		void	StartCompletion();
+		// The word being completed has changed: the last list received is
+		// filtered again, or requested again if the server said it's incomplete.
+		void	UpdateCompletion();
 		void	SelectedCompletion(const char* text);
 		void	Format();
 		void	Rename(std::string newName);
@@ -66,7 +76,7 @@ public:
 		void	StartHover(Sci_Position sci_position);
 		void	EndHover();
 		void	GetDiagnostics(std::vector<LSPDiagnostic>& diagnostics) { diagnostics = fLastDiagnostics; }
-		void	RequestCodeActions(Diagnostic& diagnostic);
+		bool	RequestCodeActions(int32 index);
 		void	CodeActionResolve(value &params);
 
 		void	IndicatorClick(Sci_Position position);
@@ -84,6 +94,11 @@ public:
 	void onResponse(RequestID ID, value &result);
 	void onError(RequestID ID, value &error);
 	void onRequest(std::string method, value &params, value &ID);
+	void onDecodedNotify(std::string method, LSPMessage &message);
+	void onDecodedResponse(RequestID ID, LSPMessage &message);
+	// the same problem reported again has the same key
+	static std::string DiagnosticKey(const Diagnostic& diagnostic);
+
 	int32 DiagnosticFromPosition(Sci_Position p, LSPDiagnostic& dia);
 	int32 DiagnosticFromRange(Range& range, LSPDiagnostic& dia);
 
@@ -97,12 +112,24 @@ public:
 	bool				fInitialized;
 
 private:
+	// didOpen has been sent
+	bool				fOpened;
+	// the document has been shown since it was last closed
+	bool				fActive;
+
 	bool	IsInitialized();
 	std::vector<LSPDiagnostic>	fLastDiagnostics;
 	std::vector<InfoRange>		fLastDocumentLinks;
 
+	// where the text replaced by the completion starts
+	Sci_Position		fCompletionStart;
+
 	void				_ShowToolTip(const char* text);
+	void				_RequestCompletion();
+	bool				_CompletionPrefix(std::string& prefix);
+	void				_ShowCompletion();
 	void				_RemoveAllDiagnostics();
+	void				_UpdateDiagnosticIndicators();
 	void				_RemoveAllDocumentLinks();
 
 
@@ -115,11 +142,11 @@ private:
 	void	_DoGoTo(nlohmann::json& params);
 	void	_DoSignatureHelp(nlohmann::json& params);
 	void	_DoSwitchSourceHeader(nlohmann::json& params);
-	void	_DoCompletion(nlohmann::json& params);
-	void	_DoDiagnostics(nlohmann::json& params);
+	void	_DoCompletion(CompletionList& allItems);
+	void	_DoDiagnostics(std::vector<Diagnostic>& vect);
 	void	_DoDocumentLink(nlohmann::json& params);
 	void	_DoFileStatus(nlohmann::json& params);
-	void	_DoDocumentSymbol(nlohmann::json& params);
+	void	_DoDocumentSymbol(LSPMessage& message);
 	void	_DoInitialize(nlohmann::json& params);
 	void	_DoCodeActions(nlohmann::json& params);
 	void	_DoCodeActionResolve(nlohmann::json& params);
@@ -128,8 +155,27 @@ private:
 	void	_DoLinearSymbolInformation(std::vector<SymbolInformation>& v, BMessage& msg);
 private:
 	//utils
+	// the last line used by a conversion, to convert the positions
+	// on the same line without asking Scintilla again
+	struct LineInfo {
+		Sci_Position	line = -1;
+		Sci_Position	start = 0;
+		Sci_Position	end = 0;
+		// the line has only single byte characters: byte offsets are
+		// the same in any encoding
+		bool			singleByte = true;
+	};
+
+	void			_SetPositionEncoding(OffsetEncoding encoding);
+	void			_GetLineInfo(Sci_Position line, LineInfo& info);
+
 	void 			FromSciPositionToLSPPosition(const Sci_Position &pos, Position *lsp_position);
+	void 			FromSciPositionToLSPPosition(const Sci_Position &pos, Position *lsp_position,
+						LineInfo& cache);
 	Sci_Position 	FromLSPPositionToSciPosition(const Position* lsp_position);
+	Sci_Position 	FromLSPPositionToSciPosition(const Position* lsp_position, LineInfo& cache);
+	void			FromLSPRangesToSciRanges(const std::vector<Range>& ranges,
+						std::vector<InfoRange>& sciRanges);
 	void 			GetCurrentLSPPosition(Position *lsp_position);
 	void 			FromSciPositionToRange(Sci_Position s_start, Sci_Position s_end, Range *range);
 	Sci_Position 	ApplyTextEdit(nlohmann::json &textEdit);
@@ -138,7 +184,22 @@ private:
 						BString edits = "");
 	std::string 	GetCurrentLine();
 	bool			IsStatusValid();
+	bool			_MergeChange(const char* text, long len, Sci_Position start,
+						Sci_Position length);
+
 	std::vector<TextDocumentContentChangeEvent> fChanges;
+	Sci_Position	fLastChangeStart;
+	size_t			fPendingBytes;
+	bigtime_t		fFirstChangeTime;
+	bool			fFullSyncPending;
+
+	// incremented each time the changes are sent to the server
+	int32			fDocumentVersion;
+	int32			fLinksVersion;
+
+	// the Scintilla line character index matching the position encoding
+	// of the server (SC_LINECHARACTERINDEX_NONE for utf-8)
+	int32			fLineIndex;
 
 };
 
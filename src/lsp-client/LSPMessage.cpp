@@ -0,0 +1,87 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "LSPMessage.h"
+
+#include "Log.h"
+#include "protocol.h"
+
+
+/* static */
+LSPMessage*
+LSPMessage::Parse(const std::string& data)
+{
+	LSPMessage* message = new LSPMessage();
+	try {
+		auto json = nlohmann::json::parse(data);
+
+		if (json.count("id")) {
+			if (json.contains("method")) {
+				message->kind = KIND_REQUEST;
+				message->method = json["method"].get<std::string>();
+				message->requestId = std::move(json["id"]);
+				message->payload = std::move(json["params"]);
+			} else if (json.contains("result")) {
+				message->kind = KIND_RESPONSE;
+				message->id = json["id"].get<std::string>();
+				message->payload = std::move(json["result"]);
+			} else if (json.contains("error")) {
+				message->kind = KIND_ERROR;
+				message->id = json["id"].get<std::string>();
+				message->payload = std::move(json["error"]);
+			} else {
+				delete message;
+				return nullptr;
+			}
+			std::size_t found = message->id.find('_');
+			if (found != std::string::npos)
+				message->method = message->id.substr(found + 1);
+		} else if (json.contains("method") && json.contains("params")) {
+			message->kind = KIND_NOTIFY;
+			message->method = json["method"].get<std::string>();
+			message->payload = std::move(json["params"]);
+		} else {
+			delete message;
+			return nullptr;
+		}
+
+		message->_Decode();
+	}
+	catch (std::exception& e) {
+		LogTrace("LSPMessage exception: %s", e.what());
+		delete message;
+		return nullptr;
+	}
+	return message;
+}
+
+
+void
+LSPMessage::_Decode()
+{
+	if (kind == KIND_NOTIFY) {
+		if (method.compare("textDocument/publishDiagnostics") == 0) {
+			diagnostics = payload["diagnostics"].get<std::vector<Diagnostic>>();
+			// keep the uri, it's needed to route the notification
+			payload.erase("diagnostics");
+			decoded = true;
+		}
+	} else if (kind == KIND_RESPONSE) {
+		if (method.compare("textDocument/completion") == 0) {
+			completion = payload.get<CompletionList>();
+			payload = value();
+			decoded = true;
+		} else if (method.compare("textDocument/documentSymbol") == 0) {
+			if (payload.is_array() && payload.size() > 0) {
+				if (payload[0]["location"].is_null())
+					symbols = payload.get<std::vector<DocumentSymbol>>();
+				else
+					symbolInformation = payload.get<std::vector<SymbolInformation>>();
+			}
+			payload = value();
+			decoded = true;
+		}
+	}
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef LSPMessage_H
+#define LSPMessage_H
+
+#include <string>
+#include <vector>
+
+#include "MessageHandler.h"
+#include "protocol_objects.h"
+
+// A message received from the LSP server, parsed (and for the biggest
+// payloads already decoded into protocol objects) by the reader thread.
+// It's handed over to the LSPProjectWrapper looper by pointer: the receiver
+// takes the ownership.
+
+struct LSPMessage {
+	enum Kind {
+		KIND_REQUEST,
+		KIND_RESPONSE,
+		KIND_ERROR,
+		KIND_NOTIFY
+	};
+
+	Kind		kind = KIND_NOTIFY;
+	std::string	method;		// for responses: the method part of the request id
+	RequestID	id;			// responses and errors
+	value		requestId;	// requests sent by the server
+	value		payload;	// params, result or error
+
+	// Decoded payloads: when decoded is true the corresponding field
+	// is filled and the json payload has been released.
+	bool							decoded = false;
+	CompletionList					completion;
+	std::vector<Diagnostic>			diagnostics;
+	std::vector<DocumentSymbol>		symbols;
+	std::vector<SymbolInformation>	symbolInformation;
+
+	static LSPMessage*	Parse(const std::string& data);
+
+private:
+	void	_Decode();
+};
+
+#endif // LSPMessage_H
@@ -10,15 +10,25 @@
 
 #include "LSPPipeClient.h"
 
+#include <algorithm>
+#include <cstring>
+#include <strings.h>
+
 #include "Log.h"
 #include "LSPReaderThread.h"
 
+static const size_t kReadBufferSize = 64 * 1024;
+static const char kHeaderTerminator[] = "\r\n\r\n";
+static const char kContentLength[] = "Content-Length:";
+
 status_t
 LSPPipeClient::Start(const char **argv, int32 argc)
 {
 	status_t image_status = fPipeImage.Init(argv, argc, false, true);
-	if (image_status == B_OK)
+	if (image_status == B_OK) {
+		fStartTime = system_time();
 		LSPPipeClient::Run();
+	}
 	return image_status;
 }
 
@@ -27,6 +37,17 @@ void
 LSPPipeClient::Close()
 {
 	fPipeImage.Close();
+
+	if (fReceivedMessages > 0) {
+		double seconds = (system_time() - fStartTime) / 1000000.0;
+		if (seconds <= 0)
+			seconds = 1;
+		LogInfo("LSP [%d] received %" B_PRIu64 " messages, %" B_PRIu64 " bytes"
+			" (%.1f msg/s, %.1f KiB/s)", GetChildPid(), fReceivedMessages, fReceivedBytes,
+			fReceivedMessages / seconds, fReceivedBytes / seconds / 1024.0);
+		fReceivedMessages = 0;
+		fReceivedBytes = 0;
+	}
 }
 
 
@@ -38,19 +59,27 @@ LSPPipeClient::~LSPPipeClient()
 
 
 bool
-LSPPipeClient::ReadHeaderLine(char* header, size_t maxlen)
+LSPPipeClient::FillReadBuffer()
 {
-	ssize_t hasRead = 0;
-	size_t length = 0;
-	while ((hasRead = fPipeImage.Read(&header[length], 1)) != -1) {
-		if (hasRead == 0 || length >= maxlen - 1) // pipe eof or protection
-			return false;
-
-		if (header[length] == '\n') {
-			break;
-		}
-		length++;
+	// move the unconsumed bytes at the beginning of the buffer
+	// so the whole tail is available for the next read
+	if (fReadStart > 0) {
+		size_t pending = fReadEnd - fReadStart;
+		if (pending > 0)
+			::memmove(fReadBuffer.data(), fReadBuffer.data() + fReadStart, pending);
+		fReadStart = 0;
+		fReadEnd = pending;
 	}
+
+	if (fReadEnd >= fReadBuffer.size()) // header bigger than the whole buffer
+		return false;
+
+	ssize_t hasRead = fPipeImage.Read(fReadBuffer.data() + fReadEnd,
+		fReadBuffer.size() - fReadEnd);
+	if (hasRead <= 0) // pipe eof or error
+		return false;
+
+	fReadEnd += hasRead;
 	return true;
 }
 
@@ -58,28 +87,57 @@ LSPPipeClient::ReadHeaderLine(char* header, size_t maxlen)
 int
 LSPPipeClient::ReadMessageHeader()
 {
-	char szReadBuffer[255];
-	int len = 0;
-	while (ReadHeaderLine(szReadBuffer, 255)) {
-		if (::strncmp(szReadBuffer, "Content-Length: ", 16) == 0) {
-			len = ::atoi(szReadBuffer + 16);
-		} else if (::strncmp(szReadBuffer, "\r\n", 2) == 0) {
-			break;
-		} else {
-			LogTrace("Unsuported LSP message header: %s", szReadBuffer);
+	const size_t terminatorLength = sizeof(kHeaderTerminator) - 1;
+	const size_t contentLength = sizeof(kContentLength) - 1;
+
+	for (;;) {
+		const char* begin = fReadBuffer.data() + fReadStart;
+		const char* end = fReadBuffer.data() + fReadEnd;
+		const char* terminator = (const char*)::memmem(begin, end - begin,
+			kHeaderTerminator, terminatorLength);
+		if (terminator == nullptr) {
+			if (!FillReadBuffer())
+				return 0;
+			continue;
 		}
+
+		// parse the header fields in place, one "\r\n" terminated line at time
+		int len = 0;
+		const char* line = begin;
+		while (line < terminator) {
+			const char* lineEnd = (const char*)::memchr(line, '\r', terminator - line + 1);
+			if (lineEnd - line > (ssize_t)contentLength
+				&& ::strncasecmp(line, kContentLength, contentLength) == 0) {
+				len = ::atoi(line + contentLength);
+			} else {
+				LogTrace("Unsuported LSP message header: %.*s", (int)(lineEnd - line), line);
+			}
+			line = lineEnd + 2;
+		}
+		fReadStart = (terminator + terminatorLength) - fReadBuffer.data();
+		return len;
 	}
-	return len;
 }
 
 
 int
 LSPPipeClient::Read(int length, std::string &out)
 {
-	int readSize = 0;
+	// take what is already buffered, then read the rest of the body
+	// straight into the destination string
+	size_t buffered = std::min((size_t)length, fReadEnd - fReadStart);
+	out.assign(fReadBuffer.data() + fReadStart, buffered);
+	fReadStart += buffered;
+	if (fReadStart == fReadEnd)
+		fReadStart = fReadEnd = 0;
+
+	int readSize = buffered;
+	if (readSize >= length)
+		return readSize;
+
 	ssize_t hasRead;
 	out.resize(length);
-	while ((hasRead = fPipeImage.Read(&out[readSize], length)) != -1) {
+	while ((hasRead = fPipeImage.Read(&out[readSize], length - readSize)) != -1) {
 		if (hasRead == 0) // pipe eof
 			return 0;
 
@@ -122,8 +180,10 @@ LSPPipeClient::readMessage(std::string &json)
 		return false;
 	//SkipLine();
 	//std::string read;
-	if (Read(length, json) == 0)
+	if (Read(length, json) < length)
 		return false;
+	fReceivedMessages++;
+	fReceivedBytes += length;
 	LogTrace("Client - rcv %d:\n%s\n", length, json.c_str());
 	return true;
 }
@@ -142,7 +202,13 @@ LSPPipeClient::writeMessage(std::string &content)
 LSPPipeClient::LSPPipeClient(uint32 what, BMessenger& msgr)
 	:
 	AsyncJsonTransport(what, msgr),
-	fReaderThread(nullptr)
+	fReaderThread(nullptr),
+	fReadBuffer(kReadBufferSize),
+	fReadStart(0),
+	fReadEnd(0),
+	fReceivedMessages(0),
+	fReceivedBytes(0),
+	fStartTime(0)
 {
 }
 
@@ -12,6 +12,8 @@
 
 #include <Locker.h>
 
+#include <vector>
+
 class LSPReaderThread;
 class LSPPipeClient : public AsyncJsonTransport {
 
@@ -35,7 +37,7 @@ public:
 
 private:
   int 	ReadMessageHeader();
-  bool	ReadHeaderLine(char* header, size_t maxlen);
+  bool	FillReadBuffer();
   int 	Read(int length, std::string &out);
   bool 	Write(std::string &in);
   void	Quit() override;
@@ -44,4 +46,14 @@ private:
   BLocker 			fWriteLock;
   LSPReaderThread*	fReaderThread;
   PipeImage			fPipeImage;
+
+  // bytes read from the pipe but not yet consumed are kept
+  // in fReadBuffer between fReadStart and fReadEnd
+  std::vector<char>	fReadBuffer;
+  size_t			fReadStart;
+  size_t			fReadEnd;
+
+  uint64			fReceivedMessages;
+  uint64			fReceivedBytes;
+  bigtime_t			fStartTime;
 };
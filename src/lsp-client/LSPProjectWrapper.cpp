@@ -4,26 +4,34 @@
  */
 #include "LSPProjectWrapper.h"
 
+#include "ConfigManager.h"
 #include "Log.h"
+#include "LSPMessage.h"
 #include "LSPPipeClient.h"
 #include "LSPReaderThread.h"
 #include "LSPTextDocument.h"
 #include "protocol.h"
 #include "LSPServersManager.h"
 
+#include <Autolock.h>
 #include <Url.h>
 
+#include <algorithm>
+#include <memory>
+
+extern ConfigManager gCFG;
+
 const int32 kLSPMessage = 'LSP!';
 
 LSPProjectWrapper::LSPProjectWrapper(BPath rootPath, const BMessenger& msgr,
 	const LSPServerConfigInterface& serverConfig) : BHandler(rootPath.Path())
+	, fLastRequestId(0)
 	, fServerConfig(serverConfig)
 	, fServerCapabilities(0U)
+	, fPositionEncoding(OffsetEncoding::UTF16)
 {
-	BUrl url(rootPath);
-	url.SetAuthority("");
-
-	fRootURI = url.UrlString();
+	fRootURI = _FolderURI(rootPath);
+	fWorkspaceFolders.push_back(fRootURI);
 	fLSPPipeClient = nullptr;
 	fInitialized.store(false);
 
@@ -34,30 +42,40 @@ void
 LSPProjectWrapper::MessageReceived(BMessage* msg)
 {
 	if (msg->what == kLSPMessage) {
-		const char* json;
-		if (msg->FindString("data", &json) == B_OK && fLSPPipeClient) {
-			try {
-				auto value = nlohmann::json::parse(json);
-
-				if (value.count("id")) {
-					if (value.contains("method")) {
-						onRequest(value["method"].get<std::string>(), value["params"], value["id"]);
-					} else if (value.contains("result")) {
-						onResponse(value["id"].get<std::string>(), value["result"]);
-					} else if (value.contains("error")) {
-						onError(value["id"].get<std::string>(), value["error"]);
-					}
-				} else if (value.contains("method")) {
-					if (value.contains("params")) {
-						onNotify(value["method"].get<std::string>(), value["params"]);
-					}
-				}
-			}
-			catch (std::exception& e) {
-				LogTrace("LSPProjectWrapper exception: %s", e.what());
-				return;
+		LSPMessage* data = nullptr;
+		if (msg->FindPointer("message", (void**)&data) != B_OK || data == nullptr)
+			return;
+
+		std::unique_ptr<LSPMessage> message(data);
+		if (!fLSPPipeClient)
+			return;
+
+		try {
+			switch (message->kind) {
+				case LSPMessage::KIND_REQUEST:
+					onRequest(message->method, message->payload, message->requestId);
+					break;
+				case LSPMessage::KIND_RESPONSE:
+					if (message->decoded)
+						onDecodedResponse(message->id, *message);
+					else
+						onResponse(message->id, message->payload);
+					break;
+				case LSPMessage::KIND_ERROR:
+					onError(message->id, message->payload);
+					break;
+				case LSPMessage::KIND_NOTIFY:
+					if (message->decoded)
+						onDecodedNotify(message->method, *message);
+					else
+						onNotify(message->method, message->payload);
+					break;
 			}
 		}
+		catch (std::exception& e) {
+			LogTrace("LSPProjectWrapper exception: %s", e.what());
+			return;
+		}
 	}
 	return;
 }
@@ -89,6 +107,41 @@ LSPProjectWrapper::UnregisterTextDocument(LSPTextDocument* textDocument)
 {
 	if (fTextDocs.find(X(textDocument)) != fTextDocs.end())
 		fTextDocs.erase(X(textDocument));
+	fOpenDocuments.remove(textDocument);
+
+	// the document is going away: nobody is waiting for these responses
+	BAutolock lock(fPendingLock);
+	for (auto it = fPendingRequests.begin(); it != fPendingRequests.end();) {
+		if (it->second.textDocument == textDocument) {
+			_CancelRequest(it->first);
+			it = fPendingRequests.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+
+void
+LSPProjectWrapper::DocumentUsed(LSPTextDocument* textDocument)
+{
+	fOpenDocuments.remove(textDocument);
+	fOpenDocuments.push_front(textDocument);
+
+	const size_t limit = std::max((int32)gCFG["lsp_max_open_documents"], (int32)1);
+	while (fOpenDocuments.size() > limit) {
+		LSPTextDocument* idle = fOpenDocuments.back();
+		fOpenDocuments.pop_back();
+		LogTrace("LSP: closing idle document [%s]", idle->GetFilenameURI().String());
+		idle->CloseIdle();
+	}
+}
+
+
+void
+LSPProjectWrapper::DocumentClosed(LSPTextDocument* textDocument)
+{
+	fOpenDocuments.remove(textDocument);
 }
 
 
@@ -141,6 +194,8 @@ LSPProjectWrapper::~LSPProjectWrapper()
 		LogError("LSPProjectWrapper::Dispose() still textDocument registered! [%s]",
 			m.second->GetFilenameURI().String());
 
+	_LogRequestStats();
+
 	Shutdown();
 	Exit();
 
@@ -156,6 +211,91 @@ LSPProjectWrapper::~LSPProjectWrapper()
 }
 
 
+void
+LSPProjectWrapper::AddWorkspaceFolder(const BPath& path)
+{
+	const std::string uri = _FolderURI(path);
+	if (std::find(fWorkspaceFolders.begin(), fWorkspaceFolders.end(), uri)
+			!= fWorkspaceFolders.end())
+		return;
+
+	fWorkspaceFolders.push_back(uri);
+	_SyncWorkspaceFolders();
+}
+
+
+void
+LSPProjectWrapper::RemoveWorkspaceFolder(const BPath& path)
+{
+	auto found = std::find(fWorkspaceFolders.begin(), fWorkspaceFolders.end(),
+		_FolderURI(path));
+	if (found == fWorkspaceFolders.end())
+		return;
+
+	fWorkspaceFolders.erase(found);
+	_SyncWorkspaceFolders();
+}
+
+
+team_id
+LSPProjectWrapper::ServerTeam()
+{
+	if (fLSPPipeClient == nullptr)
+		return -1;
+	return fLSPPipeClient->GetChildPid();
+}
+
+
+/* static */
+std::string
+LSPProjectWrapper::_FolderURI(const BPath& path)
+{
+	BUrl url(path);
+	url.SetAuthority("");
+	return url.UrlString().String();
+}
+
+
+void
+LSPProjectWrapper::_SyncWorkspaceFolders()
+{
+	// folders added or removed before the server is ready
+	// are sent after the initialize response
+	if (!fInitialized)
+		return;
+
+	// WorkspaceFolder only refers to the strings
+	std::vector<std::string> names;
+	names.reserve(fWorkspaceFolders.size() + fAnnouncedFolders.size());
+	auto folder = [&names](const std::string& uri) {
+		names.push_back(uri.substr(uri.rfind('/') + 1));
+		return WorkspaceFolder{ uri, names.back() };
+	};
+
+	DidChangeWorkspaceFoldersParams params;
+	std::set<std::string> current(fWorkspaceFolders.begin(), fWorkspaceFolders.end());
+	for (const std::string& uri : current) {
+		if (fAnnouncedFolders.find(uri) == fAnnouncedFolders.end())
+			params.event.added.push_back(folder(uri));
+	}
+	for (const std::string& uri : fAnnouncedFolders) {
+		if (current.find(uri) == current.end())
+			params.event.removed.push_back(folder(uri));
+	}
+	if (params.event.added.empty() && params.event.removed.empty())
+		return;
+
+	if (!HasCapability(kLCapWorkspaceFolders)) {
+		// clangd, for one, finds the compilation database from the file path
+		LogInfo("LSP server [%s] doesn't track workspace folders (%d folders)",
+			fServerConfig.Argv()[0], (int32)fWorkspaceFolders.size());
+	} else {
+		SendNotify("workspace/didChangeWorkspaceFolders", params);
+	}
+	fAnnouncedFolders.swap(current);
+}
+
+
 LSPTextDocument*
 LSPProjectWrapper::_DocumentByURI(const char* uri)
 {
@@ -190,56 +330,79 @@ LSPProjectWrapper::onNotify(std::string method, value& params)
 }
 
 
+void
+LSPProjectWrapper::onDecodedNotify(std::string method, LSPMessage& message)
+{
+	auto uri = message.payload["uri"].get<std::string>();
+
+	LSPTextDocument* doc = _DocumentByURI(uri.c_str());
+	if (doc)
+		doc->onDecodedNotify(method, message);
+	else
+		LogError("Can't deliver a notify from LSP to %s [%s]", uri.c_str(), method.c_str());
+}
+
+
 void
 LSPProjectWrapper::onResponse(RequestID id, value& result)
 {
-	std::size_t found = id.find('_');
-	std::string key;
-	if (found != std::string::npos) {
-		key = id.substr(0, found);
-		id = id.substr(found + 1);
-	}
+	PendingRequest request;
+	if (!_TakePendingRequest(id, request))
+		return;
 
-	if (id.compare("initialize") == 0) {
+	const std::string& method = request.method;
+	if (method.compare("initialize") == 0) {
 		fInitialized.store(true);
 		Initialized(result);
+		_SyncWorkspaceFolders();
 		for(std::pair<std::string, LSPTextDocument*> doc : fTextDocs) {
-			doc.second->onResponse(id, result);
+			doc.second->onResponse(method, result);
 		}
 		return;
 	}
-	if (id.compare("shutdown") == 0) {
+	if (method.compare("shutdown") == 0) {
 		fprintf(stderr, "Shutdown received\n");
 		fInitialized.store(false);
 		return;
 	}
 
-	auto search = fTextDocs.find(key);
-	if (search != fTextDocs.end()) {
-		search->second->onResponse(id, result);
+	if (request.textDocument != nullptr) {
+		request.textDocument->onResponse(method, result);
 	} else {
-		LogError("LSPProjectWrapper::onResponse not handled! [%s][%s] for [%s]", key.c_str(),
-			id.c_str(), key.c_str());
+		LogError("LSPProjectWrapper::onResponse not handled! [%s][%s]", id.c_str(),
+			method.c_str());
 	}
 }
 
 
 void
-LSPProjectWrapper::onError(RequestID id, value& error)
+LSPProjectWrapper::onDecodedResponse(RequestID id, LSPMessage& message)
 {
-	std::size_t found = id.find('_');
-	std::string key;
-	if (found != std::string::npos) {
-		key = id.substr(0, found);
-		id = id.substr(found + 1);
+	PendingRequest request;
+	if (!_TakePendingRequest(id, request))
+		return;
+
+	if (request.textDocument != nullptr) {
+		request.textDocument->onDecodedResponse(request.method, message);
+	} else {
+		LogError("LSPProjectWrapper::onDecodedResponse not handled! [%s][%s]", id.c_str(),
+			request.method.c_str());
 	}
+}
+
+
+void
+LSPProjectWrapper::onError(RequestID id, value& error)
+{
+	PendingRequest request;
+	if (!_TakePendingRequest(id, request))
+		return;
 
-	auto search = fTextDocs.find(key);
-	if (search != fTextDocs.end())
-		search->second->onError(id, error);
+	if (request.textDocument != nullptr)
+		request.textDocument->onError(request.method, error);
 	else
-		LogError("LSPProjectWrapper::onError not handled! [%s][%s] for [%s]", key.c_str(),
-			id.c_str(), key.c_str());
+		LogError("LSPProjectWrapper::onError not handled! [%s][%s] %s", id.c_str(),
+			request.method.c_str(), error.dump().c_str());
 }
 
 
@@ -257,21 +420,32 @@ LSPProjectWrapper::Initialize(option<DocumentUri> rootUri)
 	InitializeParams params;
 	params.processId = fLSPPipeClient->GetChildPid();
 	params.rootUri = rootUri;
-	return SendRequest("client", "initialize", params);
+
+	std::vector<std::string> names;
+	names.reserve(fWorkspaceFolders.size());
+	std::vector<WorkspaceFolder> folders;
+	for (const std::string& uri : fWorkspaceFolders) {
+		names.push_back(uri.substr(uri.rfind('/') + 1));
+		folders.push_back(WorkspaceFolder{ uri, names.back() });
+	}
+	params.workspaceFolders = std::move(folders);
+	fAnnouncedFolders = std::set<std::string>(fWorkspaceFolders.begin(), fWorkspaceFolders.end());
+
+	return SendRequest(nullptr, "initialize", params);
 }
 
 
 RequestID
 LSPProjectWrapper::Shutdown()
 {
-	return SendRequest("client", "shutdown", json());
+	return SendRequest(nullptr, "shutdown", json());
 }
 
 
 RequestID
 LSPProjectWrapper::Sync()
 {
-	return SendRequest("client", "sync", json());
+	return SendRequest(nullptr, "sync", json());
 }
 
 
@@ -337,6 +511,30 @@ LSPProjectWrapper::Initialized(json& result)
 		_CheckAndSetCapability(capas, "signatureHelpProvider", kLCapSignatureHelp);
 		_CheckAndSetCapability(capas, "renameProvider", kLCapRename);
 		_CheckAndSetCapability(capas, "documentSymbolProvider", kLCapDocumentSymbols);
+		_CheckAndSetCapability(capas, "codeActionProvider", kLCapCodeAction);
+
+		// LSP 3.17, or the older clangd extension. UTF-16 is the default.
+		fPositionEncoding = OffsetEncoding::UTF16;
+		auto& encoding = capas.contains("positionEncoding")
+			? capas["positionEncoding"] : result["offsetEncoding"];
+		if (encoding.is_string()) {
+			OffsetEncoding negotiated = encoding.get<OffsetEncoding>();
+			if (negotiated != OffsetEncoding::UnsupportedEncoding)
+				fPositionEncoding = negotiated;
+		}
+		LogInfo("LSP server [%s] position encoding: %s", fServerConfig.Argv()[0],
+			json(fPositionEncoding).get<std::string>().c_str());
+
+		auto& workspaceFolders = capas["workspace"]["workspaceFolders"];
+		if (workspaceFolders.is_object()) {
+			auto& supported = workspaceFolders["supported"];
+			auto& notifications = workspaceFolders["changeNotifications"];
+			if (supported.is_boolean() && supported.get<bool>()
+				&& ((notifications.is_boolean() && notifications.get<bool>())
+					|| notifications.is_string())) {
+				fServerCapabilities |= kLCapWorkspaceFolders;
+			}
+		}
 	}
 
 	SendNotify("initialized", json());
@@ -349,7 +547,7 @@ RequestID
 LSPProjectWrapper::RegisterCapability()
 {
 	//?
-	return SendRequest("client/registerCapability", "client/registerCapability", json());
+	return SendRequest(nullptr, "client/registerCapability", json());
 }
 
 
@@ -404,7 +602,7 @@ LSPProjectWrapper::RangeFomatting(LSPTextDocument* textDocument, Range range)
 	DocumentRangeFormattingParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.range = range;
-	return SendRequest(X(textDocument), "textDocument/rangeFormatting", params);
+	return SendRequest(textDocument, "textDocument/rangeFormatting", params);
 }
 
 
@@ -413,7 +611,7 @@ LSPProjectWrapper::FoldingRange(LSPTextDocument* textDocument)
 {
 	FoldingRangeParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
-	return SendRequest(X(textDocument), "textDocument/foldingRange", params);
+	return SendRequest(textDocument, "textDocument/foldingRange", params);
 }
 
 
@@ -423,7 +621,7 @@ LSPProjectWrapper::SelectionRange(LSPTextDocument* textDocument, std::vector<Pos
 	SelectionRangeParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.positions = std::move(positions);
-	return SendRequest(X(textDocument), "textDocument/selectionRange", params);
+	return SendRequest(textDocument, "textDocument/selectionRange", params);
 }
 
 
@@ -434,7 +632,7 @@ LSPProjectWrapper::OnTypeFormatting(LSPTextDocument* textDocument, Position posi
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
 	params.ch = std::move(ch);
-	return SendRequest(X(textDocument), "textDocument/onTypeFormatting", std::move(params));
+	return SendRequest(textDocument, "textDocument/onTypeFormatting", std::move(params));
 }
 
 
@@ -446,7 +644,7 @@ LSPProjectWrapper::Formatting(LSPTextDocument* textDocument)
 
 	DocumentFormattingParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
-	return SendRequest(X(textDocument), "textDocument/formatting", std::move(params));
+	return SendRequest(textDocument, "textDocument/formatting", std::move(params));
 }
 
 
@@ -457,20 +655,20 @@ LSPProjectWrapper::CodeAction(LSPTextDocument* textDocument, Range range, CodeAc
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.range = range;
 	params.context = context;
-	return SendRequest(X(textDocument), "textDocument/codeAction", params);
+	return SendRequest(textDocument, "textDocument/codeAction", params);
 }
 
 
 RequestID
 LSPProjectWrapper::CodeActionResolve(LSPTextDocument* textDocument, struct CodeAction& data)
 {
-	return SendRequest(X(textDocument), "codeAction/resolve", data);
+	return SendRequest(textDocument, "codeAction/resolve", data);
 }
 
 RequestID
 LSPProjectWrapper::CodeActionResolve(LSPTextDocument* textDocument, nlohmann::json& data)
 {
-	return SendRequest(X(textDocument), "codeAction/resolve", data);
+	return SendRequest(textDocument, "codeAction/resolve", data);
 }
 
 
@@ -485,7 +683,7 @@ LSPProjectWrapper::Completion(
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
 	params.context = option<CompletionContext>(context);
-	return SendRequest(X(textDocument), "textDocument/completion", params);
+	return SendRequest(textDocument, "textDocument/completion", params);
 }
 
 
@@ -498,7 +696,7 @@ LSPProjectWrapper::SignatureHelp(LSPTextDocument* textDocument, Position positio
 	TextDocumentPositionParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
-	return SendRequest(X(textDocument), "textDocument/signatureHelp", std::move(params));
+	return SendRequest(textDocument, "textDocument/signatureHelp", std::move(params));
 }
 
 
@@ -511,7 +709,7 @@ LSPProjectWrapper::GoToDefinition(LSPTextDocument* textDocument, Position positi
 	TextDocumentPositionParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
-	return SendRequest(X(textDocument), "textDocument/definition", std::move(params));
+	return SendRequest(textDocument, "textDocument/definition", std::move(params));
 }
 
 
@@ -524,7 +722,7 @@ LSPProjectWrapper::GoToImplementation(LSPTextDocument* textDocument, Position po
 	TextDocumentPositionParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
-	return SendRequest(X(textDocument), "textDocument/implementation", std::move(params));
+	return SendRequest(textDocument, "textDocument/implementation", std::move(params));
 }
 
 
@@ -537,7 +735,7 @@ LSPProjectWrapper::GoToDeclaration(LSPTextDocument* textDocument, Position posit
 	TextDocumentPositionParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
-	return SendRequest(X(textDocument), "textDocument/declaration", std::move(params));
+	return SendRequest(textDocument, "textDocument/declaration", std::move(params));
 }
 
 
@@ -547,7 +745,7 @@ LSPProjectWrapper::References(LSPTextDocument* textDocument, Position position)
 	ReferenceParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
-	return SendRequest(X(textDocument), "textDocument/references", std::move(params));
+	return SendRequest(textDocument, "textDocument/references", std::move(params));
 }
 
 
@@ -556,7 +754,7 @@ LSPProjectWrapper::SwitchSourceHeader(LSPTextDocument* textDocument)
 {
 	TextDocumentIdentifier params;
 	params.uri = std::move(textDocument->GetFilenameURI().String());
-	return SendRequest(X(textDocument), "textDocument/switchSourceHeader", std::move(params));
+	return SendRequest(textDocument, "textDocument/switchSourceHeader", std::move(params));
 }
 
 
@@ -567,7 +765,7 @@ LSPProjectWrapper::Rename(LSPTextDocument* textDocument, Position position, stri
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
 	params.newName = newName;
-	return SendRequest(X(textDocument), "textDocument/rename", std::move(params));
+	return SendRequest(textDocument, "textDocument/rename", std::move(params));
 }
 
 
@@ -580,7 +778,7 @@ LSPProjectWrapper::Hover(LSPTextDocument* textDocument, Position position)
 	TextDocumentPositionParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
-	return SendRequest(X(textDocument), "textDocument/hover", std::move(params));
+	return SendRequest(textDocument, "textDocument/hover", std::move(params));
 }
 
 
@@ -592,7 +790,7 @@ LSPProjectWrapper::DocumentSymbol(LSPTextDocument* textDocument)
 
 	DocumentSymbolParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
-	return SendRequest(X(textDocument), "textDocument/documentSymbol", std::move(params));
+	return SendRequest(textDocument, "textDocument/documentSymbol", std::move(params));
 }
 
 
@@ -601,7 +799,7 @@ LSPProjectWrapper::DocumentColor(LSPTextDocument* textDocument)
 {
 	DocumentSymbolParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
-	return SendRequest(X(textDocument), "textDocument/documentColor", std::move(params));
+	return SendRequest(textDocument, "textDocument/documentColor", std::move(params));
 }
 
 
@@ -611,7 +809,7 @@ LSPProjectWrapper::DocumentHighlight(LSPTextDocument* textDocument, Position pos
 	TextDocumentPositionParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
-	return SendRequest(X(textDocument), "textDocument/documentHighlight", std::move(params));
+	return SendRequest(textDocument, "textDocument/documentHighlight", std::move(params));
 }
 
 
@@ -621,7 +819,7 @@ LSPProjectWrapper::SymbolInfo(LSPTextDocument* textDocument, Position position)
 	TextDocumentPositionParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
 	params.position = position;
-	return SendRequest(X(textDocument), "textDocument/symbolInfo", std::move(params));
+	return SendRequest(textDocument, "textDocument/symbolInfo", std::move(params));
 }
 
 
@@ -634,7 +832,7 @@ LSPProjectWrapper::TypeHierarchy(
 	params.position = position;
 	params.direction = direction;
 	params.resolve = resolve;
-	return SendRequest(X(textDocument), "textDocument/typeHierarchy", std::move(params));
+	return SendRequest(textDocument, "textDocument/typeHierarchy", std::move(params));
 }
 
 
@@ -646,19 +844,141 @@ LSPProjectWrapper::DocumentLink(LSPTextDocument* textDocument)
 
 	DocumentLinkParams params;
 	params.textDocument.uri = std::move(textDocument->GetFilenameURI().String());
-	return SendRequest(X(textDocument), "textDocument/documentLink", std::move(params));
+	return SendRequest(textDocument, "textDocument/documentLink", std::move(params));
 }
 
 
 RequestID
-LSPProjectWrapper::SendRequest(RequestID id, string_ref method, value params)
-{
+LSPProjectWrapper::SendRequest(LSPTextDocument* textDocument, string_ref method, value params)
+{
+	BAutolock lock(fPendingLock);
+
+	// A newer request supersedes the one still running for the same document:
+	// ask the server to drop the old one and forget about its response.
+	if (textDocument != nullptr && _IsSupersedable(method)) {
+		for (auto it = fPendingRequests.begin(); it != fPendingRequests.end(); ++it) {
+			if (it->second.textDocument == textDocument && it->second.method.compare(method.c_str()) == 0) {
+				LogTrace("LSP request superseded [%s]", it->first.c_str());
+				_CancelRequest(it->first);
+				fPendingRequests.erase(it);
+				break;
+			}
+		}
+	}
+
+	RequestID id = std::to_string(++fLastRequestId);
 	id.append("_").append(method);
+
+	PendingRequest& request = fPendingRequests[id];
+	request.textDocument = textDocument;
+	request.method = method;
+	request.sentTime = system_time();
+
 	fLSPPipeClient->request(method, params, id);
 	return id;
 }
 
 
+bool
+LSPProjectWrapper::_TakePendingRequest(const RequestID& id, PendingRequest& request)
+{
+	BAutolock lock(fPendingLock);
+	auto search = fPendingRequests.find(id);
+	if (search == fPendingRequests.end()) {
+		// cancelled, superseded or its document is gone.
+		LogTrace("LSPProjectWrapper: dropping stale response [%s]", id.c_str());
+		return false;
+	}
+	request = search->second;
+	fPendingRequests.erase(search);
+
+	// latency histogram per method
+	bigtime_t elapsed = system_time() - request.sentTime;
+	LatencyStats& stats = fLatencyStats[request.method];
+	size_t bucket = 0;
+	while (bucket < kLatencyBucketCount - 1 && elapsed > kLatencyBuckets[bucket])
+		bucket++;
+	stats.count[bucket]++;
+	stats.total += elapsed;
+	stats.max = std::max(stats.max, elapsed);
+	return true;
+}
+
+
+void
+LSPProjectWrapper::_CancelRequest(const RequestID& id)
+{
+	json params = {{"id", id}};
+	SendNotify("$/cancelRequest", params);
+}
+
+
+bool
+LSPProjectWrapper::_IsSupersedable(string_ref method)
+{
+	static const char* kSupersedable[] = {
+		"textDocument/completion",
+		"textDocument/hover",
+		"textDocument/signatureHelp",
+		"textDocument/documentHighlight",
+		"textDocument/documentLink",
+		"textDocument/documentSymbol",
+	};
+	for (const char* name : kSupersedable) {
+		if (::strcmp(method.c_str(), name) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+void
+LSPProjectWrapper::GetRequestStats(BMessage* stats)
+{
+	BAutolock lock(fPendingLock);
+	stats->MakeEmpty();
+	stats->AddInt32("pending", fPendingRequests.size());
+	for (auto& [method, latency] : fLatencyStats) {
+		BMessage entry;
+		entry.AddString("method", method.c_str());
+		int32 count = 0;
+		for (size_t i = 0; i < kLatencyBucketCount; i++) {
+			// the last bucket has no upper bound
+			entry.AddInt64("bucket", i < kLatencyBucketCount - 1 ? kLatencyBuckets[i] : -1);
+			entry.AddInt32("count", latency.count[i]);
+			count += latency.count[i];
+		}
+		entry.AddInt64("average", count > 0 ? latency.total / count : 0);
+		entry.AddInt64("max", latency.max);
+		stats->AddMessage("method", &entry);
+	}
+}
+
+
+void
+LSPProjectWrapper::_LogRequestStats()
+{
+	if (!Logger::IsInfoEnabled())
+		return;
+
+	BAutolock lock(fPendingLock);
+	for (auto& [method, latency] : fLatencyStats) {
+		BString line;
+		int32 count = 0;
+		for (size_t i = 0; i < kLatencyBucketCount; i++) {
+			if (i < kLatencyBucketCount - 1)
+				line << " <" << kLatencyBuckets[i] / 1000 << "ms:" << latency.count[i];
+			else
+				line << " more:" << latency.count[i];
+			count += latency.count[i];
+		}
+		LogInfo("LSP [%s] %d responses, avg %" B_PRId64 "ms, max %" B_PRId64 "ms,%s",
+			method.c_str(), count, count > 0 ? latency.total / count / 1000 : 0,
+			latency.max / 1000, line.String());
+	}
+}
+
+
 void
 LSPProjectWrapper::SendNotify(string_ref method, value params = json())
 {
@@ -9,6 +9,8 @@
 #include <Path.h>
 #include <Locker.h>
 #include <atomic>
+#include <list>
+#include <set>
 #include <MessageFilter.h>
 #include <Messenger.h>
 
@@ -30,6 +32,7 @@ struct FileEvent;
 struct WorkspaceEdit;
 struct ConfigurationSettings;
 enum class TypeHierarchyDirection: int;
+enum class OffsetEncoding;
 class LSPPipeClient;
 class LSPServerConfigInterface;
 
@@ -51,13 +54,31 @@ public:
 	bool	RegisterTextDocument(LSPTextDocument* fw);
 	void	UnregisterTextDocument(LSPTextDocument* fw);
 
+	// The documents opened on the server (didOpen), most recently used
+	// first. Beyond "lsp_max_open_documents" the oldest ones are closed.
+	void	DocumentUsed(LSPTextDocument* textDocument);
+	void	DocumentClosed(LSPTextDocument* textDocument);
+
     void onNotify(std::string method, value &params);
     void onResponse(RequestID ID, value &result);
     void onError(RequestID ID, value &error);
     void onRequest(std::string method, value &params, value &ID);
+    void onDecodedNotify(std::string method, LSPMessage &message);
+    void onDecodedResponse(RequestID ID, LSPMessage &message);
 
 
 	bool HasCapability(const LSPCapability flag);
+	// how the characters of a Position are counted, negotiated on initialize
+	OffsetEncoding	PositionEncoding() const { return fPositionEncoding; }
+
+	// The projects served by the same server (see LSPServersManager).
+	// The first one is the root of the server.
+	void	AddWorkspaceFolder(const BPath& path);
+	void	RemoveWorkspaceFolder(const BPath& path);
+	int32	CountWorkspaceFolders() const { return fWorkspaceFolders.size(); }
+
+	// the language server process, -1 if not running
+	team_id	ServerTeam();
 
 
 public:
@@ -97,9 +118,12 @@ public:
     RequestID TypeHierarchy(LSPTextDocument* textDocument, Position position, TypeHierarchyDirection direction, int resolve);
     RequestID DocumentLink(LSPTextDocument* textDocument);
 
-    RequestID 	SendRequest(RequestID id, string_ref method, value params);
+    RequestID 	SendRequest(LSPTextDocument* textDocument, string_ref method, value params);
     void 		SendNotify(string_ref method, value params);
 
+    // per method response latency histograms, for diagnostics
+    void		GetRequestStats(BMessage* stats);
+
     std::string&	allCommitCharacters() { return fAllCommitCharacters; } //not yet used.
     std::string&	triggerCharacters() { return fTriggerCharacters; } //for completion
 
@@ -108,10 +132,39 @@ private:
 	LSPPipeClient*			fLSPPipeClient;
 	LSPTextDocument*	_DocumentByURI(const char* uri);
 	bool _CheckAndSetCapability(json& capas, const char* str, const LSPCapability flag);
+	static std::string	_FolderURI(const BPath& path);
+	void	_SyncWorkspaceFolders();
 
 	typedef std::map<std::string, LSPTextDocument*> MapFile;
 
 	MapFile	fTextDocs;
+	std::list<LSPTextDocument*>	fOpenDocuments;
+
+	struct PendingRequest {
+		LSPTextDocument*	textDocument = nullptr;
+		std::string			method;
+		bigtime_t			sentTime = 0;
+	};
+
+	static constexpr size_t kLatencyBucketCount = 8;
+	static constexpr bigtime_t kLatencyBuckets[kLatencyBucketCount - 1] = {
+		10000, 50000, 100000, 250000, 500000, 1000000, 5000000 };
+
+	struct LatencyStats {
+		int32		count[kLatencyBucketCount] = {};
+		bigtime_t	total = 0;
+		bigtime_t	max = 0;
+	};
+
+	bool	_TakePendingRequest(const RequestID& id, PendingRequest& request);
+	void	_CancelRequest(const RequestID& id);
+	bool	_IsSupersedable(string_ref method);
+	void	_LogRequestStats();
+
+	BLocker									fPendingLock;
+	std::map<RequestID, PendingRequest>		fPendingRequests;
+	std::map<std::string, LatencyStats>		fLatencyStats;
+	int64									fLastRequestId;
 
 	std::atomic<bool> fInitialized;
 
@@ -119,9 +172,13 @@ private:
 	std::string fTriggerCharacters;
 
 	std::string fRootURI;
+	std::vector<std::string>	fWorkspaceFolders;
+	// the folders the server has been told about
+	std::set<std::string>		fAnnouncedFolders;
 	BMessenger fMessenger;
 	const LSPServerConfigInterface& fServerConfig;
 	uint32	fServerCapabilities;
+	OffsetEncoding	fPositionEncoding;
 };
 
 #endif // _H_LSPProjectWrapper
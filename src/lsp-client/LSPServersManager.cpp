@@ -12,6 +12,8 @@
 #include "LSPLogLevels.h"
 #include "LSPProjectWrapper.h"
 
+#include <OS.h>
+
 #include <string>
 #include <vector>
 
@@ -115,6 +117,8 @@ public:
 
 
 std::vector<LSPServerConfigInterface*> LSPServersManager::fConfigs;
+std::map<const LSPServerConfigInterface*, LSPProjectWrapper*> LSPServersManager::fSharedServers;
+std::set<LSPProjectWrapper*> LSPServersManager::fServers;
 
 
 /* static */
@@ -155,12 +159,72 @@ LSPServersManager::DisposeLSPServersConfig()
 
 /* static */
 LSPProjectWrapper*
-LSPServersManager::CreateLSPProject(const BPath& path, const BMessenger& msgr, const BString& fileType)
+LSPServersManager::AcquireLSPProject(const BPath& path, const BMessenger& msgr, const BString& fileType)
 {
 	for (LSPServerConfigInterface* interface: fConfigs) {
-		if (interface->IsFileTypeSupported(fileType)) {
-			return new LSPProjectWrapper(path, msgr, *interface);
+		if (!interface->IsFileTypeSupported(fileType))
+			continue;
+
+		if (!(bool)gCFG["lsp_shared_server"]) {
+			LSPProjectWrapper* wrapper = new LSPProjectWrapper(path, msgr, *interface);
+			fServers.insert(wrapper);
+			return wrapper;
 		}
+
+		auto shared = fSharedServers.find(interface);
+		if (shared != fSharedServers.end()) {
+			shared->second->AddWorkspaceFolder(path);
+			return shared->second;
+		}
+		LSPProjectWrapper* wrapper = new LSPProjectWrapper(path, msgr, *interface);
+		fSharedServers[interface] = wrapper;
+		fServers.insert(wrapper);
+		return wrapper;
 	}
 	return nullptr;
 }
+
+
+/* static */
+void
+LSPServersManager::ReleaseLSPProject(LSPProjectWrapper* wrapper, const BPath& path)
+{
+	if (fServers.find(wrapper) == fServers.end())
+		return;
+
+	LogServersMemory();
+
+	auto shared = fSharedServers.find(&wrapper->ServerConfig());
+	if (shared != fSharedServers.end() && shared->second == wrapper) {
+		wrapper->RemoveWorkspaceFolder(path);
+		if (wrapper->CountWorkspaceFolders() > 0)
+			return;
+		fSharedServers.erase(shared);
+	}
+	fServers.erase(wrapper);
+	delete wrapper;
+}
+
+
+/* static */
+void
+LSPServersManager::LogServersMemory()
+{
+	int32 count = 0;
+	int32 projects = 0;
+	size_t resident = 0;
+	for (LSPProjectWrapper* wrapper : fServers) {
+		projects += wrapper->CountWorkspaceFolders();
+		team_id team = wrapper->ServerTeam();
+		if (team < 0)
+			continue;
+		count++;
+		ssize_t cookie = 0;
+		area_info info;
+		while (get_next_area_info(team, &cookie, &info) == B_OK)
+			resident += info.ram_size;
+	}
+	LogInfo("LSP servers: %d running for %d projects (%s), %" B_PRIuSIZE " KiB resident",
+		count, projects,
+		fSharedServers.empty() ? "one per project" : "shared", resident / 1024);
+}
@@ -7,6 +7,8 @@
 
 
 #include <SupportDefs.h>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <Entry.h>
@@ -29,14 +31,24 @@ protected:
 	int32 fOffset;
 };
 
+// With "lsp_shared_server" enabled all the projects share one server per
+// language: each project is a workspace folder of the same LSPProjectWrapper.
+// Otherwise every project gets its own server.
 class LSPServersManager {
 public:
 		static status_t				InitLSPServersConfig();
-		static LSPProjectWrapper*	CreateLSPProject(const BPath& path, const BMessenger& msgr, const BString& fileType);
+		static LSPProjectWrapper*	AcquireLSPProject(const BPath& path, const BMessenger& msgr, const BString& fileType);
+		static void					ReleaseLSPProject(LSPProjectWrapper* wrapper, const BPath& path);
 		static status_t				DisposeLSPServersConfig();
+
+		// logs the memory used by the running language servers
+		static void					LogServersMemory();
 private:
 		static bool _AddValidConfig(LSPServerConfigInterface*);
 		static std::vector<LSPServerConfigInterface*>	fConfigs;
+
+		static std::map<const LSPServerConfigInterface*, LSPProjectWrapper*>	fSharedServers;
+		static std::set<LSPProjectWrapper*>				fServers;
 };
 
 
@@ -26,6 +26,10 @@ public:
 
 	const BString& FileType() const { return fFileType; }
 
+	// The server has too many open documents: this one, not used recently,
+	// should be closed. It is opened again when needed.
+	virtual	void	CloseIdle() {}
+
 private:
 	BUrl 	fFilenameURI;
 	BString	fFileStatus;
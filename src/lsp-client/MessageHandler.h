@@ -14,6 +14,7 @@
 using value = nlohmann::json;
 using RequestID = std::string;
 
+struct LSPMessage;
 class MessageHandler {
 public:
     MessageHandler() = default;
@@ -22,6 +23,10 @@ public:
     virtual void onError(RequestID ID, value &error) {}
     virtual void onRequest(std::string method, value &params, value &ID) {}
 
+    // payloads already decoded into protocol objects by the reader thread
+    virtual void onDecodedNotify(std::string method, LSPMessage &message) {}
+    virtual void onDecodedResponse(RequestID ID, LSPMessage &message) {}
+
 };
 
 
@@ -3,12 +3,12 @@
 
 #include "Transport.h"
 #include "json.hpp"
+#include "LSPMessage.h"
 #include <Messenger.h>
 #define    jsonrpc  "2.0"
 ///////////////////////
 
 enum {
-	kReadResult		= 'read',
 	kWriteRequest	= 'writ'
 };
 
@@ -38,9 +38,18 @@ AsyncJsonTransport::readStep()
 	std::string data;
 	bool result = readMessage(data);
 	if(result){
-		BMessage req(kReadResult);
-		req.AddString("data", data.c_str());
-		return (BLooper::PostMessage(&req) == B_OK);
+		// parse and decode here, on the reader thread, then hand the
+		// message over to the target looper which takes the ownership.
+		LSPMessage* message = LSPMessage::Parse(data);
+		if (message == nullptr)
+			return true;
+
+		BMessage req(fWhat);
+		req.AddPointer("message", message);
+		if (fMessenger.SendMessage(&req) != B_OK) {
+			delete message;
+			return false;
+		}
 	}
     return result;
 }
@@ -50,15 +59,6 @@ AsyncJsonTransport::MessageReceived(BMessage* msg)
 {
 	switch(msg->what) {
 
-		case kReadResult: {
-			const char* data;
-			if (msg->FindString("data", &data) == B_OK) {
-				msg->what = fWhat;
-				fMessenger.SendMessage(msg);
-			}
-			break;
-		}
-
 		case kWriteRequest: {
 			const char* data;
 			if (msg->FindString("data", &data) == B_OK) {
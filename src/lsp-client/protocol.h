@@ -303,11 +303,19 @@ struct ClientCapabilities {
 
     /// Supported encodings for LSP character offsets. (clangd extension).
     std::vector<OffsetEncoding> offsetEncoding = {OffsetEncoding::UTF8};
+    /// Supported position encodings, the preferred first (LSP 3.17).
+    /// general.positionEncodings
+    std::vector<OffsetEncoding> PositionEncodings = {OffsetEncoding::UTF8,
+        OffsetEncoding::UTF16, OffsetEncoding::UTF32};
     /// The content format that should be used for Hover requests.
     std::vector<MarkupKind> HoverContentFormat = {MarkupKind::PlainText};
 
     bool ApplyEdit = false;
     bool DocumentChanges = false;
+
+    /// Client supports multiple workspace folders.
+    /// workspace.workspaceFolders
+    bool WorkspaceFolders = true;
     ClientCapabilities() {
         for (int i = 1; i <= 26; ++i) {
             WorkspaceSymbolKinds.push_back((SymbolKind) i);
@@ -321,6 +329,8 @@ struct ClientCapabilities {
     }
 };
 JSON_SERIALIZE(ClientCapabilities,MAP_JSON(
+            MAP_KV("general",
+                MAP_TO("positionEncodings", PositionEncodings)),
             MAP_KV("textDocument",
                 MAP_KV("publishDiagnostics", // PublishDiagnosticsClientCapabilities
                         MAP_TO("categorySupport", DiagnosticCategory),
@@ -349,6 +359,7 @@ JSON_SERIALIZE(ClientCapabilities,MAP_JSON(
                             MAP_KV("symbolKind",
                                     MAP_TO("valueSet", WorkspaceSymbolKinds))),
                     MAP_TO("applyEdit", ApplyEdit),
+                    MAP_TO("workspaceFolders", WorkspaceFolders),
                     MAP_KV("workspaceEdit", // WorkspaceEditClientCapabilities
                             MAP_TO("documentChanges", DocumentChanges))),
             MAP_TO("offsetEncoding", offsetEncoding)), {});
@@ -417,19 +428,40 @@ JSON_SERIALIZE(InitializationOptions, MAP_JSON(
                 MAP_KEY(fallbackFlags),
                 MAP_KEY(clangdFileStatus)), {});
 
+struct WorkspaceFolder {
+    /// The associated URI for this workspace folder.
+    DocumentUri uri;
+    /// The name of the workspace folder, used to refer to it in the user interface.
+    TextType name;
+};
+JSON_SERIALIZE(WorkspaceFolder, MAP_JSON(MAP_KEY(uri), MAP_KEY(name)), {});
+
+struct WorkspaceFoldersChangeEvent {
+    std::vector<WorkspaceFolder> added;
+    std::vector<WorkspaceFolder> removed;
+};
+JSON_SERIALIZE(WorkspaceFoldersChangeEvent, MAP_JSON(MAP_KEY(added), MAP_KEY(removed)), {});
+
+struct DidChangeWorkspaceFoldersParams {
+    WorkspaceFoldersChangeEvent event;
+};
+JSON_SERIALIZE(DidChangeWorkspaceFoldersParams, MAP_JSON(MAP_KEY(event)), {});
+
 struct InitializeParams {
     unsigned processId = 0;
     ClientCapabilities capabilities;
     option<DocumentUri> rootUri;
     option<TextType> rootPath;
     InitializationOptions initializationOptions;
+    option<std::vector<WorkspaceFolder>> workspaceFolders;
 };
 JSON_SERIALIZE(InitializeParams, MAP_JSON(
         MAP_KEY(processId),
         MAP_KEY(capabilities),
         MAP_KEY(rootUri),
         MAP_KEY(initializationOptions),
-        MAP_KEY(rootPath)), {});
+        MAP_KEY(rootPath),
+        MAP_KEY(workspaceFolders)), {});
 
 enum class MessageType {
     /// An error message.
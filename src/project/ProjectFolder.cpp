@@ -15,9 +15,13 @@
 #include "ConfigManager.h"
 #include "LSPProjectWrapper.h"
 #include "LSPServersManager.h"
+#include "GitStatus.h"
+#include "ProjectIndex.h"
 #include "GenioNamespace.h"
 #include "GSettings.h"
 
+extern ConfigManager gCFG;
+
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "ProjectSettingsWindow"
 
@@ -54,6 +58,15 @@ SourceItem::SourceItem(const entry_ref& ref)
 }
 
 
+SourceItem::SourceItem(const entry_ref& ref, SourceItemType type)
+	:
+	fEntryRef(ref),
+	fType(type),
+	fProjectFolder(nullptr)
+{
+}
+
+
 SourceItem::~SourceItem()
 {
 }
@@ -88,7 +101,9 @@ ProjectFolder::ProjectFolder(const entry_ref& ref, BMessenger& msgr)
 	fSettings(nullptr),
 	fMessenger(msgr),
 	fGitRepository(nullptr),
-	fIsBuilding(false)
+	fIsBuilding(false),
+	fIndex(nullptr),
+	fGitStatus(nullptr)
 {
 	fProjectFolder = this;
 	fType = SourceItemType::ProjectFolderItem;
@@ -111,7 +126,7 @@ ProjectFolder::GetLSPServer(const BString& fileType)
 		if (w->ServerConfig().IsFileTypeSupported(fileType))
 			return w;
 	}
-	LSPProjectWrapper* wrap = LSPServersManager::CreateLSPProject(BPath(fFullPath), fMessenger, fileType);
+	LSPProjectWrapper* wrap = LSPServersManager::AcquireLSPProject(BPath(fFullPath), fMessenger, fileType);
 	if (wrap)
 		fLSPProjectWrappers.push_back(wrap);
 	return wrap;
@@ -121,10 +136,13 @@ ProjectFolder::GetLSPServer(const BString& fileType)
 ProjectFolder::~ProjectFolder()
 {
 	for (LSPProjectWrapper* w : fLSPProjectWrappers) {
-		delete w;
+		LSPServersManager::ReleaseLSPProject(w, BPath(fFullPath));
 	}
+	delete fGitStatus;
 	delete fGitRepository;
 	delete fSettings;
+	if (fIndex != nullptr)
+		fIndex->ReleaseReference();
 }
 
 
@@ -139,6 +157,10 @@ ProjectFolder::Open()
 	if (status != B_OK)
 		LogInfoF("%s", "Cannot load project settings");
 
+	UpdateIndex();
+
+	_StartGitStatus();
+
 	// not a fatal error, just start with defaults
 	return B_OK;
 }
@@ -148,10 +170,32 @@ status_t
 ProjectFolder::Close()
 {
 	SaveSettings();
+	if (fIndex != nullptr)
+		fIndex->Stop();
+	if (fGitStatus != nullptr)
+		fGitStatus->Stop();
 	return B_OK;
 }
 
 
+void
+ProjectFolder::UpdateIndex()
+{
+	// a search still running keeps its reference to the old index
+	if (fIndex != nullptr) {
+		fIndex->Stop();
+		fIndex->ReleaseReference();
+		fIndex = nullptr;
+	}
+
+	if ((bool)(*fSettings)["project_search_index"]) {
+		BString excludeDir(gCFG["find_exclude_directory"]);
+		fIndex = new ProjectIndex(Path(), excludeDir);
+		fIndex->Start();
+	}
+}
+
+
 BString const
 ProjectFolder::Path() const
 {
@@ -380,6 +424,19 @@ void
 ProjectFolder::InitRepository(bool createInitialCommit)
 {
 	fGitRepository->Init(createInitialCommit);
+	_StartGitStatus();
+}
+
+
+void
+ProjectFolder::_StartGitStatus()
+{
+	if (fGitStatus != nullptr || fGitRepository == nullptr
+		|| !fGitRepository->IsInitialized()) {
+		return;
+	}
+	fGitStatus = new GitStatus(Path(), fMessenger);
+	fGitStatus->Start();
 }
 
 
@@ -441,6 +498,9 @@ ProjectFolder::_PrepareSettings()
 	fSettings->AddConfig(B_TRANSLATE("Run"), "project_run_in_terminal",
 		B_TRANSLATE("Run in terminal"), false);
 
+	fSettings->AddConfig(B_TRANSLATE("Search"), "project_search_index",
+		B_TRANSLATE("Index files to speed up \"Find in project\""), false);
+
 	fSettings->NoticeMessage()->AddPointer("project_folder", reinterpret_cast<void*>(this));
 }
 
@@ -13,12 +13,17 @@
 
 #include "GitRepository.h"
 
+namespace Genio::Git {
+	class GitStatus;
+}
+
 using namespace Genio::Git;
 
 class BMessenger;
 class ConfigManager;
 class LSPProjectWrapper;
 class LSPTextDocument;
+class ProjectIndex;
 
 const uint32 kMsgProjectSettingsUpdated = 'PRJS';
 
@@ -39,6 +44,7 @@ class SourceItem {
 public:
 					explicit	SourceItem(const BString& path);
 					explicit	SourceItem(const entry_ref& ref);
+								SourceItem(const entry_ref& ref, SourceItemType type);
 								~SourceItem();
 
 	const entry_ref*			EntryRef() const;
@@ -102,11 +108,18 @@ public:
 
 	GitRepository*				GetRepository() const;
 	void						InitRepository(bool createInitialCommit = true);
+	// nullptr if the project is not a git repository
+	GitStatus*					GetGitStatus() const { return fGitStatus; }
 
 	const rgb_color				Color() const;
 
 	LSPProjectWrapper*			GetLSPServer(const BString& fileType);
 
+	// nullptr when the search index is disabled for the project
+	ProjectIndex*				Index() const { return fIndex; }
+	// rebuilds the index after its settings changed
+	void						UpdateIndex();
+
 private:
 	void						_PrepareSettings();
 	status_t					_LoadOldSettings();
@@ -118,4 +131,8 @@ private:
 	GitRepository*				fGitRepository;
 	bool						fIsBuilding;
 	BString						fFullPath;
+	ProjectIndex*				fIndex;
+	GitStatus*					fGitStatus;
+
+	void						_StartGitStatus();
 };
@@ -0,0 +1,808 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+
+#include "ProjectIndex.h"
+
+#include <Autolock.h>
+#include <Directory.h>
+#include <File.h>
+#include <Message.h>
+#include <NodeMonitor.h>
+#include <Path.h>
+#include <StringList.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "GenioNamespace.h"
+#include "Log.h"
+#include "Utils.h"
+
+static const uint32 kIndexMagic = 'GIDX';
+static const uint32 kIndexVersion = 2;
+
+// bigger files are not indexed and always searched
+static const off_t kMaxIndexedFileSize = 16 * 1024 * 1024;
+// as FindInFilesThread: a file with a NUL byte in its first block is binary
+static const size_t kBinaryCheckSize = 32 * 1024;
+
+
+static inline uint32
+Trigram(const char* text)
+{
+	return ((uint32)tolower((unsigned char)text[0]) << 16)
+		| ((uint32)tolower((unsigned char)text[1]) << 8)
+		| (uint32)tolower((unsigned char)text[2]);
+}
+
+
+static void
+ExtractTrigrams(const char* text, size_t length, std::vector<uint32>& trigrams)
+{
+	trigrams.clear();
+	if (length < 3)
+		return;
+	trigrams.reserve(std::min(length, (size_t)64 * 1024));
+	for (size_t i = 0; i + 2 < length; i++)
+		trigrams.push_back(Trigram(text + i));
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+	trigrams.shrink_to_fit();
+}
+
+
+static inline int64
+ModificationTime(const struct stat& st)
+{
+	return (int64)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+
+template<typename T>
+static inline void
+Write(std::string& buffer, const T& value)
+{
+	buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+
+template<typename T>
+static inline bool
+Read(const char*& position, const char* end, T& value)
+{
+	if ((size_t)(end - position) < sizeof(T))
+		return false;
+	memcpy(&value, position, sizeof(T));
+	position += sizeof(T);
+	return true;
+}
+
+
+ProjectIndex::ProjectIndex(const BString& path, const BString& excludeDirectories)
+	:
+	fPath(path.String()),
+	fExcludeString(excludeDirectories),
+	fLock("ProjectIndex"),
+	fDirty(false),
+	fChangeSem(create_sem(0, "ProjectIndex changes")),
+	fThread(-1),
+	fStopRequested(false),
+	fReady(false)
+{
+	while (fPath.length() > 1 && fPath.back() == '/')
+		fPath.pop_back();
+
+	BStringList directories;
+	excludeDirectories.Split(",", true, directories);
+	for (int32 i = 0; i < directories.CountStrings(); i++) {
+		BString directory = directories.StringAt(i);
+		directory.Trim();
+		if (!directory.IsEmpty())
+			fExcludeDirectories.push_back(directory);
+	}
+}
+
+
+ProjectIndex::~ProjectIndex()
+{
+	Stop();
+	delete_sem(fChangeSem);
+}
+
+
+status_t
+ProjectIndex::Start()
+{
+	if (fThread >= 0)
+		return B_OK;
+
+	fThread = spawn_thread(_RunThread, "ProjectIndex", B_LOW_PRIORITY, this);
+	if (fThread < 0)
+		return fThread;
+
+	return resume_thread(fThread);
+}
+
+
+void
+ProjectIndex::Stop()
+{
+	if (fThread < 0)
+		return;
+
+	fStopRequested = true;
+	release_sem(fChangeSem);
+
+	status_t exitValue;
+	wait_for_thread(fThread, &exitValue);
+	fThread = -1;
+}
+
+
+void
+ProjectIndex::EntryChanged(BMessage* message)
+{
+	int32 opCode;
+	if (message->FindInt32("opcode", &opCode) != B_OK)
+		return;
+
+	std::vector<Change> changes;
+	const char* path;
+	switch (opCode) {
+		case B_ENTRY_CREATED:
+			if (message->FindString("path", &path) == B_OK)
+				changes.push_back({ false, path });
+			break;
+		case B_ENTRY_REMOVED:
+			if (message->FindString("path", &path) == B_OK)
+				changes.push_back({ true, path });
+			break;
+		case B_ENTRY_MOVED:
+			if (message->FindString("from path", &path) == B_OK)
+				changes.push_back({ true, path });
+			if (!message->GetBool("removed", false)
+					&& message->FindString("path", &path) == B_OK)
+				changes.push_back({ false, path });
+			break;
+		default:
+			return;
+	}
+
+	if (changes.empty())
+		return;
+
+	{
+		BAutolock lock(fLock);
+		for (Change& change : changes)
+			fChanges.push_back(std::move(change));
+	}
+	release_sem_etc(fChangeSem, changes.size(), B_DO_NOT_RESCHEDULE);
+}
+
+
+status_t
+ProjectIndex::Query(const std::string& text, const BString& excludeDirectories,
+	std::vector<std::string>& files)
+{
+	if (!fReady)
+		return B_BUSY;
+	if (text.length() < 3)
+		return B_BAD_VALUE;
+	if (excludeDirectories != fExcludeString)
+		return B_MISMATCHED_VALUES;
+
+	bigtime_t start = system_time();
+
+	std::vector<uint32> trigrams;
+	ExtractTrigrams(text.data(), text.length(), trigrams);
+
+	struct Candidate {
+		std::string	path;
+		int64		modified;
+		int64		size;
+	};
+	// files which don't contain the text according to the index, to be
+	// checked for changes we haven't been notified of
+	std::vector<Candidate> unchanged;
+
+	{
+		BAutolock lock(fLock);
+
+		std::vector<const std::vector<uint32>*> postings;
+		for (uint32 trigram : trigrams) {
+			auto found = fPostings.find(trigram);
+			if (found == fPostings.end()) {
+				postings.clear();
+				break;
+			}
+			postings.push_back(&found->second);
+		}
+
+		// intersect the posting lists, starting with the smallest one
+		std::vector<uint32> matches;
+		if (!postings.empty()) {
+			std::sort(postings.begin(), postings.end(),
+				[](const std::vector<uint32>* a, const std::vector<uint32>* b) {
+					return a->size() < b->size();
+				});
+			matches = *postings[0];
+			std::vector<uint32> intersection;
+			for (size_t i = 1; i < postings.size() && !matches.empty(); i++) {
+				intersection.clear();
+				std::set_intersection(matches.begin(), matches.end(),
+					postings[i]->begin(), postings[i]->end(),
+					std::back_inserter(intersection));
+				matches.swap(intersection);
+			}
+		}
+
+		auto match = matches.begin();
+		for (uint32 id = 0; id < fFiles.size(); id++) {
+			const IndexedFile& file = fFiles[id];
+			bool isMatch = match != matches.end() && *match == id;
+			if (isMatch)
+				match++;
+
+			if (file.state == kRemoved)
+				continue;
+			if (isMatch || file.state == kUnindexed)
+				files.push_back(_AbsolutePath(file.path));
+			else
+				unchanged.push_back({ file.path, file.modified, file.size });
+		}
+	}
+
+	const size_t candidates = files.size();
+	std::vector<Change> changes;
+	for (const Candidate& candidate : unchanged) {
+		std::string path = _AbsolutePath(candidate.path);
+		struct stat st;
+		if (lstat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+		if (ModificationTime(st) == candidate.modified && st.st_size == candidate.size)
+			continue;
+		changes.push_back({ false, path });
+		files.push_back(std::move(path));
+	}
+
+	if (!changes.empty()) {
+		{
+			BAutolock lock(fLock);
+			for (Change& change : changes)
+				fChanges.push_back(std::move(change));
+		}
+		release_sem_etc(fChangeSem, changes.size(), B_DO_NOT_RESCHEDULE);
+	}
+
+	LogInfo("ProjectIndex: query [%s] %d candidates, %d changed files, %d skipped in %" B_PRId64
+		" us", text.c_str(), (int32)candidates, (int32)changes.size(),
+		(int32)(unchanged.size() - changes.size()), system_time() - start);
+
+	return B_OK;
+}
+
+
+/* static */
+status_t
+ProjectIndex::_RunThread(void* cookie)
+{
+	static_cast<ProjectIndex*>(cookie)->_Run();
+	return B_OK;
+}
+
+
+void
+ProjectIndex::_Run()
+{
+	bigtime_t start = system_time();
+
+	status_t status = _Load();
+	if (status != B_OK && status != B_ENTRY_NOT_FOUND)
+		LogError("ProjectIndex: can't load index for %s: %s", fPath.c_str(), ::strerror(status));
+
+	// bring the loaded index up to date
+	std::vector<bool> seen;
+	{
+		BAutolock lock(fLock);
+		seen.resize(fFiles.size(), false);
+	}
+	int32 reindexed = 0;
+	_Walk("", seen, reindexed);
+	if (fStopRequested)
+		return;
+
+	{
+		BAutolock lock(fLock);
+		for (uint32 id = 0; id < seen.size(); id++) {
+			if (!seen[id] && fFiles[id].state != kRemoved)
+				_Remove(id);
+		}
+	}
+
+	fReady = true;
+	_Report("built", system_time() - start, reindexed);
+	if (fDirty)
+		_Save();
+
+	while (!fStopRequested) {
+		if (acquire_sem(fChangeSem) != B_OK)
+			break;
+
+		Change change;
+		{
+			BAutolock lock(fLock);
+			if (fChanges.empty())
+				continue;
+			change = std::move(fChanges.front());
+			fChanges.pop_front();
+		}
+		_ProcessChange(change);
+	}
+
+	if (fDirty)
+		_Save();
+}
+
+
+void
+ProjectIndex::_Walk(const std::string& relativePath, std::vector<bool>& seen,
+	int32& reindexed)
+{
+	const std::string directory = _AbsolutePath(relativePath);
+	DIR* dir = opendir(directory.c_str());
+	if (dir == nullptr)
+		return;
+
+	struct dirent* entry;
+	while (!fStopRequested && (entry = readdir(dir)) != nullptr) {
+		const char* name = entry->d_name;
+		if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+			continue;
+
+		std::string child(relativePath);
+		if (!child.empty())
+			child.append("/");
+		child.append(name);
+
+		struct stat st;
+		if (lstat(_AbsolutePath(child).c_str(), &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			if (!_IsExcluded(name))
+				_Walk(child, seen, reindexed);
+			continue;
+		}
+		if (!S_ISREG(st.st_mode))
+			continue;
+
+		{
+			BAutolock lock(fLock);
+			auto found = fIds.find(child);
+			if (found != fIds.end()) {
+				const IndexedFile& file = fFiles[found->second];
+				if (file.modified == ModificationTime(st) && file.size == st.st_size) {
+					if (found->second < seen.size())
+						seen[found->second] = true;
+					continue;
+				}
+			}
+		}
+
+		IndexedFile file;
+		if (!_IndexFile(child, st, file))
+			continue;
+
+		BAutolock lock(fLock);
+		uint32 id = _Commit(std::move(file));
+		if (id < seen.size())
+			seen[id] = true;
+		reindexed++;
+	}
+	closedir(dir);
+}
+
+
+void
+ProjectIndex::_ProcessChange(const Change& change)
+{
+	std::string relativePath;
+	if (!_RelativePath(change.path.c_str(), relativePath))
+		return;
+	if (_IsExcludedPath(relativePath))
+		return;
+
+	if (change.removed)
+		_RemoveEntry(relativePath);
+	else
+		_UpdateEntry(relativePath);
+}
+
+
+void
+ProjectIndex::_UpdateEntry(const std::string& relativePath)
+{
+	struct stat st;
+	if (lstat(_AbsolutePath(relativePath).c_str(), &st) != 0)
+		return;
+
+	if (S_ISDIR(st.st_mode)) {
+		// a new (or moved) folder: index its content
+		std::vector<bool> seen;
+		int32 reindexed = 0;
+		_Walk(relativePath, seen, reindexed);
+		LogTrace("ProjectIndex: indexed %d files in %s", reindexed, relativePath.c_str());
+	} else if (S_ISREG(st.st_mode)) {
+		IndexedFile file;
+		if (!_IndexFile(relativePath, st, file))
+			return;
+		BAutolock lock(fLock);
+		_Commit(std::move(file));
+	}
+}
+
+
+void
+ProjectIndex::_RemoveEntry(const std::string& relativePath)
+{
+	// the entry can be either a file or a whole folder
+	const std::string prefix = relativePath + "/";
+
+	BAutolock lock(fLock);
+	for (uint32 id = 0; id < fFiles.size(); id++) {
+		const IndexedFile& file = fFiles[id];
+		if (file.state == kRemoved)
+			continue;
+		if (file.path == relativePath || file.path.compare(0, prefix.length(), prefix) == 0)
+			_Remove(id);
+	}
+}
+
+
+bool
+ProjectIndex::_IndexFile(const std::string& relativePath, const struct stat& st,
+	IndexedFile& file) const
+{
+	file.path = relativePath;
+	file.modified = ModificationTime(st);
+	file.size = st.st_size;
+	file.state = kIndexed;
+	file.trigrams.clear();
+
+	if (st.st_size == 0)
+		return true;
+	if (st.st_size > kMaxIndexedFileSize) {
+		file.state = kUnindexed;
+		return true;
+	}
+
+	int fd = open(_AbsolutePath(relativePath).c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	const size_t size = st.st_size;
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+		return false;
+
+	const char* text = static_cast<const char*>(mapped);
+	if (memchr(text, '\0', std::min(size, kBinaryCheckSize)) != nullptr)
+		file.state = kBinary;
+	else
+		ExtractTrigrams(text, size, file.trigrams);
+
+	munmap(mapped, size);
+	return true;
+}
+
+
+uint32
+ProjectIndex::_Commit(IndexedFile&& file)
+{
+	auto found = fIds.find(file.path);
+	if (found != fIds.end())
+		_Remove(found->second);
+
+	uint32 id;
+	if (!fFreeIds.empty()) {
+		id = fFreeIds.back();
+		fFreeIds.pop_back();
+	} else {
+		id = fFiles.size();
+		fFiles.emplace_back();
+	}
+
+	for (uint32 trigram : file.trigrams) {
+		std::vector<uint32>& posting = fPostings[trigram];
+		if (posting.empty() || posting.back() < id)
+			posting.push_back(id);
+		else
+			posting.insert(std::lower_bound(posting.begin(), posting.end(), id), id);
+	}
+
+	fIds[file.path] = id;
+	fFiles[id] = std::move(file);
+	fDirty = true;
+	return id;
+}
+
+
+void
+ProjectIndex::_Remove(uint32 id)
+{
+	IndexedFile& file = fFiles[id];
+	for (uint32 trigram : file.trigrams) {
+		auto found = fPostings.find(trigram);
+		if (found == fPostings.end())
+			continue;
+		std::vector<uint32>& posting = found->second;
+		auto position = std::lower_bound(posting.begin(), posting.end(), id);
+		if (position != posting.end() && *position == id)
+			posting.erase(position);
+		if (posting.empty())
+			fPostings.erase(found);
+	}
+
+	fIds.erase(file.path);
+	file.path.clear();
+	file.trigrams = std::vector<uint32>();
+	file.state = kRemoved;
+	fFreeIds.push_back(id);
+	fDirty = true;
+}
+
+
+bool
+ProjectIndex::_IsExcluded(const char* name) const
+{
+	for (const BString& pattern : fExcludeDirectories) {
+		if (fnmatch(pattern.String(), name, 0) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+bool
+ProjectIndex::_IsExcludedPath(const std::string& relativePath) const
+{
+	// every folder in the path is checked against the excluded ones
+	size_t start = 0;
+	size_t slash;
+	while ((slash = relativePath.find('/', start)) != std::string::npos) {
+		if (_IsExcluded(relativePath.substr(start, slash - start).c_str()))
+			return true;
+		start = slash + 1;
+	}
+	return false;
+}
+
+
+bool
+ProjectIndex::_RelativePath(const char* path, std::string& relativePath) const
+{
+	const size_t length = fPath.length();
+	if (strncmp(path, fPath.c_str(), length) != 0 || path[length] != '/')
+		return false;
+	relativePath = path + length + 1;
+	return !relativePath.empty();
+}
+
+
+std::string
+ProjectIndex::_AbsolutePath(const std::string& relativePath) const
+{
+	if (relativePath.empty())
+		return fPath;
+	std::string path(fPath);
+	path.append("/").append(relativePath);
+	return path;
+}
+
+
+std::string
+ProjectIndex::_IndexPath() const
+{
+	// FNV-1a of the project path: it's stable across runs
+	uint64 hash = 14695981039346656037ULL;
+	for (const char c : fPath) {
+		hash ^= (uint8)c;
+		hash *= 1099511628211ULL;
+	}
+	char name[32];
+	snprintf(name, sizeof(name), "%016" B_PRIx64, hash);
+
+	BPath path = GetUserSettingsDirectory();
+	path.Append(GenioNames::kProjectIndexDirectory);
+	path.Append(name);
+	return path.Path() != nullptr ? path.Path() : "";
+}
+
+
+status_t
+ProjectIndex::_Load()
+{
+	std::string path = _IndexPath();
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return B_ENTRY_NOT_FOUND;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return B_BAD_DATA;
+	}
+
+	const size_t size = st.st_size;
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+		return B_NO_MEMORY;
+
+	const char* position = static_cast<const char*>(mapped);
+	const char* end = position + size;
+
+	std::vector<IndexedFile> files;
+	bool valid = false;
+	uint32 magic, version, length, count;
+	if (Read(position, end, magic) && magic == kIndexMagic
+		&& Read(position, end, version) && version == kIndexVersion
+		&& Read(position, end, length) && length <= (size_t)(end - position)) {
+		// skip the index of another project with the same hash
+		valid = fPath == std::string(position, length);
+		position += length;
+	}
+	if (valid && Read(position, end, length) && length <= (size_t)(end - position)) {
+		// an index built with other folders excluded is useless
+		valid = fExcludeString == BString(position, length);
+		position += length;
+	} else
+		valid = false;
+
+	if (valid && Read(position, end, count)) {
+		files.reserve(count);
+		for (uint32 i = 0; i < count && valid; i++) {
+			IndexedFile file;
+			uint32 trigrams;
+			valid = Read(position, end, length) && length <= (size_t)(end - position);
+			if (!valid)
+				break;
+			file.path.assign(position, length);
+			position += length;
+			valid = Read(position, end, file.modified) && Read(position, end, file.size)
+				&& Read(position, end, file.state) && Read(position, end, trigrams)
+				&& trigrams <= (end - position) / sizeof(uint32);
+			if (!valid)
+				break;
+			file.trigrams.resize(trigrams);
+			memcpy(file.trigrams.data(), position, trigrams * sizeof(uint32));
+			position += trigrams * sizeof(uint32);
+			files.push_back(std::move(file));
+		}
+		valid = valid && files.size() == count;
+	}
+
+	munmap(mapped, size);
+
+	if (!valid) {
+		LogInfo("ProjectIndex: discarding index of %s", fPath.c_str());
+		return B_OK;
+	}
+
+	// ids are assigned in order, so the posting lists are built sorted
+	BAutolock lock(fLock);
+	fFiles.clear();
+	fIds.clear();
+	fPostings.clear();
+	fFreeIds.clear();
+	fFiles.reserve(files.size());
+	for (IndexedFile& file : files) {
+		uint32 id = fFiles.size();
+		for (uint32 trigram : file.trigrams)
+			fPostings[trigram].push_back(id);
+		fIds[file.path] = id;
+		fFiles.push_back(std::move(file));
+	}
+	fDirty = false;
+	return B_OK;
+}
+
+
+status_t
+ProjectIndex::_Save()
+{
+	bigtime_t start = system_time();
+
+	std::string buffer;
+	{
+		BAutolock lock(fLock);
+		Write(buffer, kIndexMagic);
+		Write(buffer, kIndexVersion);
+		Write(buffer, (uint32)fPath.length());
+		buffer.append(fPath);
+		Write(buffer, (uint32)fExcludeString.Length());
+		buffer.append(fExcludeString.String(), fExcludeString.Length());
+
+		uint32 count = fFiles.size() - fFreeIds.size();
+		Write(buffer, count);
+		for (const IndexedFile& file : fFiles) {
+			if (file.state == kRemoved)
+				continue;
+			Write(buffer, (uint32)file.path.length());
+			buffer.append(file.path);
+			Write(buffer, file.modified);
+			Write(buffer, file.size);
+			Write(buffer, file.state);
+			Write(buffer, (uint32)file.trigrams.size());
+			buffer.append(reinterpret_cast<const char*>(file.trigrams.data()),
+				file.trigrams.size() * sizeof(uint32));
+		}
+		fDirty = false;
+	}
+
+	// write a temporary file and replace the index only when complete
+	std::string path = _IndexPath();
+	BPath folder(path.c_str());
+	if (path.empty() || folder.GetParent(&folder) != B_OK
+		|| create_directory(folder.Path(), 0755) != B_OK) {
+		LogError("ProjectIndex: can't create the folder of the index of %s", fPath.c_str());
+		return B_ERROR;
+	}
+	std::string temporaryPath = path + ".tmp";
+	BFile file(temporaryPath.c_str(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status == B_OK) {
+		ssize_t written = file.Write(buffer.data(), buffer.length());
+		if (written < 0)
+			status = written;
+		else if ((size_t)written != buffer.length())
+			status = B_IO_ERROR;
+	}
+	file.Unset();
+
+	if (status == B_OK && rename(temporaryPath.c_str(), path.c_str()) != 0)
+		status = errno;
+
+	if (status != B_OK) {
+		unlink(temporaryPath.c_str());
+		LogError("ProjectIndex: can't save index of %s: %s", fPath.c_str(), ::strerror(status));
+		return status;
+	}
+
+	LogInfo("ProjectIndex: saved %d KiB for %s in %" B_PRId64 " ms",
+		(int32)(buffer.length() / 1024), fPath.c_str(), (system_time() - start) / 1000);
+	return B_OK;
+}
+
+
+void
+ProjectIndex::_Report(const char* what, bigtime_t elapsed, int32 reindexed)
+{
+	BAutolock lock(fLock);
+	size_t memory = 0;
+	int32 files = 0;
+	for (const IndexedFile& file : fFiles) {
+		memory += sizeof(IndexedFile) + file.path.capacity()
+			+ file.trigrams.capacity() * sizeof(uint32);
+		if (file.state != kRemoved)
+			files++;
+	}
+	for (const auto& posting : fPostings)
+		memory += sizeof(posting) + posting.second.capacity() * sizeof(uint32);
+
+	LogInfo("ProjectIndex: %s for %s: %d files (%d reindexed), %d trigrams, %d KiB in memory,"
+		" %" B_PRId64 " ms", what, fPath.c_str(), files, reindexed, (int32)fPostings.size(),
+		(int32)(memory / 1024), elapsed / 1000);
+}
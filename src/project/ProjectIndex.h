@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#pragma once
+
+#include <Locker.h>
+#include <OS.h>
+#include <Referenceable.h>
+#include <String.h>
+
+#include <sys/stat.h>
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class BMessage;
+
+// Trigram index of the files of a project, used by "Find in project" to
+// search only the files which can contain the text.
+// The index is saved in the Genio settings folder, in a file named after
+// the path of the project.
+// When the project is opened it's loaded and brought up to date by a
+// background thread, which then keeps it updated with the path monitor
+// events received by the ProjectBrowser.
+// Files changed without a notification (i.e. modified in place) are detected
+// by Query(), which compares their modification time with the indexed one.
+
+class ProjectIndex : public BReferenceable {
+public:
+							ProjectIndex(const BString& path,
+								const BString& excludeDirectories);
+							~ProjectIndex();
+
+			status_t		Start();
+			void			Stop();
+
+			bool			IsReady() const { return fReady; }
+
+			// B_PATH_MONITOR notifications of the project folder
+			void			EntryChanged(BMessage* message);
+
+			// Fills 'files' with the absolute paths of the files which can
+			// contain 'text'. Returns B_BUSY while the index is being built,
+			// B_BAD_VALUE if 'text' is too short to use the index.
+			status_t		Query(const std::string& text,
+								const BString& excludeDirectories,
+								std::vector<std::string>& files);
+
+private:
+	enum FileState {
+		kIndexed,
+		kBinary,
+		kUnindexed,		// too big, always searched
+		kRemoved
+	};
+
+	struct IndexedFile {
+		std::string				path;
+		int64					modified;
+		int64					size;
+		uint8					state;
+		std::vector<uint32>		trigrams;
+	};
+
+	struct Change {
+		bool					removed;
+		std::string				path;
+	};
+
+	static	status_t		_RunThread(void* cookie);
+			void			_Run();
+
+			void			_Walk(const std::string& relativePath,
+								std::vector<bool>& seen, int32& reindexed);
+			void			_ProcessChange(const Change& change);
+			void			_UpdateEntry(const std::string& relativePath);
+			void			_RemoveEntry(const std::string& relativePath);
+
+			bool			_IndexFile(const std::string& relativePath,
+								const struct stat& st, IndexedFile& file) const;
+			uint32			_Commit(IndexedFile&& file);
+			void			_Remove(uint32 id);
+
+			bool			_IsExcluded(const char* name) const;
+			bool			_IsExcludedPath(const std::string& relativePath) const;
+			bool			_RelativePath(const char* path,
+								std::string& relativePath) const;
+			std::string		_AbsolutePath(const std::string& relativePath) const;
+			std::string		_IndexPath() const;
+
+			status_t		_Load();
+			status_t		_Save();
+			void			_Report(const char* what, bigtime_t elapsed,
+								int32 reindexed);
+
+	std::string								fPath;
+	BString									fExcludeString;
+	std::vector<BString>					fExcludeDirectories;
+
+	mutable BLocker							fLock;
+	std::vector<IndexedFile>				fFiles;
+	std::vector<uint32>						fFreeIds;
+	std::unordered_map<std::string, uint32>	fIds;
+	std::unordered_map<uint32, std::vector<uint32>>	fPostings;
+	bool									fDirty;
+
+	std::deque<Change>						fChanges;
+	sem_id									fChangeSem;
+
+	thread_id								fThread;
+	std::atomic<bool>						fStopRequested;
+	std::atomic<bool>						fReady;
+};
@@ -85,7 +85,9 @@ ProjectItem::ProjectItem(SourceItem *sourceItem)
 	fSourceItem(sourceItem),
 	fNeedsSave(false),
 	fOpenedInEditor(false),
-	fRenaming(false)
+	fRenaming(false),
+	fPopulated(true),
+	fPlaceholder(false)
 {
 }
 
@@ -24,6 +24,16 @@ public:
 	void			SetNeedsSave(bool needs);
 	void			SetOpenedInEditor(bool open);
 
+	// A folder is populated when its content is read, usually when
+	// expanded for the first time: until then it only has a placeholder
+	bool			IsPopulated() const { return fPopulated; }
+	void			SetPopulated(bool populated) { fPopulated = populated; }
+
+	// The child shown by a folder not populated yet: it has the entry of
+	// the folder, and it's never selected, renamed or deleted
+	bool			IsPlaceholder() const { return fPlaceholder; }
+	void			SetPlaceholder(bool placeholder) { fPlaceholder = placeholder; }
+
 	void			InitRename(BView* owner, BMessage* message);
 	void			AbortRename();
 	void			CommitRename();
@@ -37,6 +47,8 @@ private:
 	bool			fNeedsSave;
 	bool			fOpenedInEditor;
 	bool			fRenaming;
+	bool			fPopulated;
+	bool			fPlaceholder;
 
 	static BTextControl	*sTextControl;
 
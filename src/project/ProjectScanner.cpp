@@ -0,0 +1,335 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+
+#include "ProjectScanner.h"
+
+#include <Autolock.h>
+#include <Message.h>
+#include <NaturalCompare.h>
+#include <StringList.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+
+#include "Log.h"
+
+// folders scanned before notifying the target
+static const size_t kScanBatch = 64;
+// prefetching of a project stops when this many of its entries are
+// waiting to be displayed
+static const size_t kMaxCachedEntries = 200000;
+
+
+ProjectScanner::ProjectScanner(const BMessenger& target)
+	:
+	fTarget(target),
+	fLock("ProjectScanner"),
+	fReadingChanged(false),
+	fQueueSem(create_sem(0, "ProjectScanner queue")),
+	fThread(-1),
+	fStopRequested(false)
+{
+}
+
+
+ProjectScanner::~ProjectScanner()
+{
+	if (fThread >= 0) {
+		fStopRequested = true;
+		release_sem(fQueueSem);
+		status_t exitValue;
+		wait_for_thread(fThread, &exitValue);
+	}
+	delete_sem(fQueueSem);
+}
+
+
+void
+ProjectScanner::AddProject(const BString& path, const BString& excludeDirectories)
+{
+	{
+		BAutolock lock(fLock);
+		fExcludeDirectories.clear();
+		BStringList directories;
+		excludeDirectories.Split(",", true, directories);
+		for (int32 i = 0; i < directories.CountStrings(); i++) {
+			BString directory = directories.StringAt(i);
+			directory.Trim();
+			if (!directory.IsEmpty())
+				fExcludeDirectories.push_back(directory);
+		}
+		fQueue.push_back(path.String());
+		fProjects.insert(path.String());
+	}
+
+	if (fThread < 0) {
+		fThread = spawn_thread(_RunThread, "ProjectScanner", B_LOW_PRIORITY, this);
+		if (fThread >= 0)
+			resume_thread(fThread);
+	}
+	release_sem(fQueueSem);
+}
+
+
+void
+ProjectScanner::RemoveProject(const BString& path)
+{
+	const std::string root(path.String());
+	const std::string prefix = root + "/";
+
+	BAutolock lock(fLock);
+	fQueue.erase(std::remove_if(fQueue.begin(), fQueue.end(),
+		[&](const std::string& folder) {
+			return folder == root || folder.compare(0, prefix.length(), prefix) == 0;
+		}), fQueue.end());
+	_Erase(root);
+	fProjects.erase(root);
+	fCachedEntries.erase(root);
+}
+
+
+bool
+ProjectScanner::TakeFolder(const BString& path, Folder& folder)
+{
+	BAutolock lock(fLock);
+	auto found = fFolders.find(path.String());
+	if (found == fFolders.end())
+		return false;
+
+	_Uncache(found->first, found->second.entries.size());
+	folder = std::move(found->second);
+	fFolders.erase(found);
+	return true;
+}
+
+
+void
+ProjectScanner::Invalidate(const BString& path)
+{
+	std::string entry(path.String());
+
+	BAutolock lock(fLock);
+
+	// the parent folder content has changed
+	const size_t slash = entry.rfind('/');
+	if (slash != std::string::npos && slash > 0) {
+		const std::string parent = entry.substr(0, slash);
+		if (parent == fReading)
+			fReadingChanged = true;
+		auto found = fFolders.find(parent);
+		if (found != fFolders.end()) {
+			_Uncache(found->first, found->second.entries.size());
+			fFolders.erase(found);
+		}
+	}
+	_Erase(entry);
+}
+
+
+/* static */
+status_t
+ProjectScanner::ReadFolder(const char* path, Folder& folder)
+{
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return errno;
+
+	DIR* dir = opendir(path);
+	if (dir == nullptr)
+		return errno;
+
+	folder.device = st.st_dev;
+	folder.node = st.st_ino;
+	folder.entries.clear();
+
+	std::string child(path);
+	child.append("/");
+	const size_t length = child.length();
+
+	struct dirent* dirEntry;
+	while ((dirEntry = readdir(dir)) != nullptr) {
+		const char* name = dirEntry->d_name;
+		if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+			continue;
+
+		// symbolic links are not followed, as BEntry does by default
+		child.resize(length);
+		child.append(name);
+		const bool isFolder = lstat(child.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+		folder.entries.push_back({ name, isFolder });
+	}
+	closedir(dir);
+
+	std::sort(folder.entries.begin(), folder.entries.end(),
+		[](const Entry& a, const Entry& b) {
+			if (a.isFolder != b.isFolder)
+				return a.isFolder;
+			return BPrivate::NaturalCompare(a.name.c_str(), b.name.c_str()) < 0;
+		});
+
+	return B_OK;
+}
+
+
+/* static */
+status_t
+ProjectScanner::_RunThread(void* cookie)
+{
+	static_cast<ProjectScanner*>(cookie)->_Run();
+	return B_OK;
+}
+
+
+void
+ProjectScanner::_Run()
+{
+	std::vector<std::string> empty;
+	size_t scanned = 0;
+	size_t entries = 0;
+	bigtime_t start = system_time();
+
+	while (!fStopRequested) {
+		std::string path;
+		{
+			BAutolock lock(fLock);
+			if (fQueue.empty()) {
+				lock.Unlock();
+				_SendScanned(empty);
+				if (scanned > 0) {
+					LogInfo("ProjectScanner: %d folders, %d entries read in %" B_PRId64 " ms",
+						(int32)scanned, (int32)entries, (system_time() - start) / 1000);
+				}
+				if (acquire_sem(fQueueSem) != B_OK)
+					break;
+				scanned = entries = 0;
+				start = system_time();
+				continue;
+			}
+			path = std::move(fQueue.front());
+			fQueue.pop_front();
+			fReading = path;
+			fReadingChanged = false;
+		}
+
+		Folder folder;
+		status_t status = ReadFolder(path.c_str(), folder);
+
+		BAutolock lock(fLock);
+		fReading.clear();
+		if (status != B_OK || fReadingChanged) {
+			// if changed while reading, it will be read again when expanded
+			continue;
+		}
+
+		scanned++;
+		entries += folder.entries.size();
+		if (folder.entries.empty())
+			empty.push_back(path);
+
+		// breadth first: the folders closer to the root are expanded first
+		for (const Entry& entry : folder.entries) {
+			if (entry.isFolder && !_IsExcluded(entry.name.c_str()))
+				fQueue.push_back(path + "/" + entry.name);
+		}
+
+		// the ProjectBrowser reads the project folder itself when opening it
+		if (fProjects.find(path) == fProjects.end()) {
+			const std::string project = _ProjectOf(path);
+			size_t& cached = fCachedEntries[project];
+			cached += folder.entries.size();
+			fFolders[path] = std::move(folder);
+			if (cached > kMaxCachedEntries) {
+				// the other projects keep being prefetched
+				const size_t queued = fQueue.size();
+				fQueue.erase(std::remove_if(fQueue.begin(), fQueue.end(),
+					[&](const std::string& pending) {
+						return _ProjectOf(pending) == project;
+					}), fQueue.end());
+				LogInfo("ProjectScanner: %d entries of %s prefetched, %d folders left to be read on demand",
+					(int32)cached, project.c_str(), (int32)(queued - fQueue.size()));
+			}
+		}
+		lock.Unlock();
+
+		if (scanned % kScanBatch == 0)
+			_SendScanned(empty);
+	}
+}
+
+
+void
+ProjectScanner::_SendScanned(std::vector<std::string>& empty)
+{
+	if (empty.empty())
+		return;
+
+	BMessage message(MSG_PROJECT_FOLDERS_SCANNED);
+	for (const std::string& path : empty)
+		message.AddString("empty", path.c_str());
+	fTarget.SendMessage(&message);
+	empty.clear();
+}
+
+
+bool
+ProjectScanner::_IsExcluded(const char* name) const
+{
+	for (const BString& pattern : fExcludeDirectories) {
+		if (fnmatch(pattern.String(), name, 0) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+void
+ProjectScanner::_Erase(const std::string& path)
+{
+	// the folder and everything below it
+	auto found = fFolders.find(path);
+	if (found != fFolders.end()) {
+		_Uncache(found->first, found->second.entries.size());
+		fFolders.erase(found);
+	}
+
+	const std::string prefix = path + "/";
+	if (fReading == path || fReading.compare(0, prefix.length(), prefix) == 0)
+		fReadingChanged = true;
+
+	found = fFolders.lower_bound(prefix);
+	while (found != fFolders.end() && found->first.compare(0, prefix.length(), prefix) == 0) {
+		_Uncache(found->first, found->second.entries.size());
+		found = fFolders.erase(found);
+	}
+}
+
+
+std::string
+ProjectScanner::_ProjectOf(const std::string& path) const
+{
+	// the innermost project, if they are nested
+	std::string project;
+	for (const std::string& root : fProjects) {
+		if (root.length() > project.length() && path.compare(0, root.length(), root) == 0
+			&& (path.length() == root.length() || path[root.length()] == '/')) {
+			project = root;
+		}
+	}
+	return project;
+}
+
+
+void
+ProjectScanner::_Uncache(const std::string& path, size_t entries)
+{
+	auto found = fCachedEntries.find(_ProjectOf(path));
+	if (found != fCachedEntries.end())
+		found->second -= std::min(found->second, entries);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#pragma once
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <String.h>
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+enum {
+	MSG_PROJECT_FOLDERS_SCANNED = 'pfsc'
+};
+
+// Reads in background the folders of the opened projects, so the
+// ProjectBrowser can create the items of a folder when it's expanded
+// without touching the disk.
+// Folders matching the excluded patterns are listed but not descended into.
+// After each batch of folders the target receives a
+// MSG_PROJECT_FOLDERS_SCANNED message with the "empty" paths found.
+
+class ProjectScanner {
+public:
+	struct Entry {
+		std::string		name;
+		bool			isFolder;
+	};
+
+	struct Folder {
+		dev_t				device;
+		ino_t				node;
+		std::vector<Entry>	entries;		// folders first, natural order
+	};
+
+							ProjectScanner(const BMessenger& target);
+							~ProjectScanner();
+
+			void			AddProject(const BString& path,
+								const BString& excludeDirectories);
+			void			RemoveProject(const BString& path);
+
+			// Moves the prefetched content of a folder into 'folder'.
+			// Returns false if the folder hasn't been read yet.
+			bool			TakeFolder(const BString& path, Folder& folder);
+
+			// The entry at 'path' was created, removed or moved
+			void			Invalidate(const BString& path);
+
+	static	status_t		ReadFolder(const char* path, Folder& folder);
+
+private:
+	static	status_t		_RunThread(void* cookie);
+			void			_Run();
+			void			_SendScanned(std::vector<std::string>& empty);
+			bool			_IsExcluded(const char* name) const;
+			void			_Erase(const std::string& path);
+			std::string		_ProjectOf(const std::string& path) const;
+			void			_Uncache(const std::string& path, size_t entries);
+
+	BMessenger						fTarget;
+	std::vector<BString>			fExcludeDirectories;
+
+	BLocker							fLock;
+	std::deque<std::string>			fQueue;
+	std::map<std::string, Folder>	fFolders;
+	std::set<std::string>			fProjects;
+	std::map<std::string, size_t>	fCachedEntries;		// by project
+	std::string						fReading;
+	bool							fReadingChanged;
+	sem_id							fQueueSem;
+
+	thread_id						fThread;
+	std::atomic<bool>				fStopRequested;
+};
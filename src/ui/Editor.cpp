@@ -9,16 +9,23 @@
 
 #include "Editor.h"
 
+#include <functional>
 #include <string>
 #include <regex>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <Alert.h>
 #include <Application.h>
 #include <Catalog.h>
 #include <Control.h>
 #include <ControlLook.h>
-#include <editorconfig/editorconfig.h>
 #include <ILexer.h>
+#include <ILoader.h>
 #include <Lexilla.h>
 #include <NodeMonitor.h>
 #include <Path.h>
@@ -27,10 +34,14 @@
 #include <Volume.h>
 
 #include "ConfigManager.h"
+#include "EditorConfigCache.h"
 #include "EditorContextMenu.h"
 #include "EditorMessages.h"
 #include "EditorStatusView.h"
+#include "EditorTabManager.h"
+#include "FSUtils.h"
 #include "GenioApp.h"
+#include "GenioNamespace.h"
 #include "GenioWindowMessages.h"
 #include "GoToLineWindow.h"
 #include "ResourceImport.h"
@@ -41,6 +52,7 @@
 #include "ProjectFolder.h"
 #include "ScintillaUtils.h"
 #include "Styler.h"
+#include "TextUtils.h"
 #include "Utils.h"
 
 
@@ -52,12 +64,164 @@ using namespace Sci::Properties;
 
 const int kIdleTimeout = 500000; //1/2sec
 
+// Files are passed to Scintilla in chunks of this size
+const size_t kLoadChunkSize = 4 * 1024 * 1024;
+// Load time and memory are logged for files bigger than this
+const off_t kLargeFileSize = 8 * 1024 * 1024;
+
 // Differentiate unset parameters from 0 ones
 // in scintilla messages
 #define UNSET 0
 #define UNUSED 0
 
 
+// Looks, while a file is being loaded, for the end of line used by the
+// first line and checks whether the text is valid UTF-8.
+class LoadScanner {
+public:
+	LoadScanner()
+		:
+		fEndOfLine(-1),
+		fPendingCR(false),
+		fContinuation(0),
+		fValidUTF8(true)
+	{
+	}
+
+	void Scan(const char* data, size_t length)
+	{
+		if (fEndOfLine < 0)
+			_ScanEndOfLine(data, length);
+		if (fValidUTF8)
+			_ScanUTF8(reinterpret_cast<const uint8*>(data), length);
+	}
+
+	int32 EndOfLine() const
+	{
+		if (fEndOfLine >= 0)
+			return fEndOfLine;
+		// no line end at all: use default LF
+		return fPendingCR ? SC_EOL_CR : SC_EOL_LF;
+	}
+
+	bool IsValidUTF8() const { return fValidUTF8 && fContinuation == 0; }
+
+private:
+	void _ScanEndOfLine(const char* data, size_t length)
+	{
+		if (fPendingCR) {
+			fEndOfLine = data[0] == '\n' ? SC_EOL_CRLF : SC_EOL_CR;
+			return;
+		}
+		for (size_t i = 0; i < length; i++) {
+			if (data[i] == '\n') {
+				fEndOfLine = SC_EOL_LF;
+				return;
+			}
+			if (data[i] == '\r') {
+				if (i + 1 == length)
+					fPendingCR = true;
+				else
+					fEndOfLine = data[i + 1] == '\n' ? SC_EOL_CRLF : SC_EOL_CR;
+				return;
+			}
+		}
+	}
+
+	void _ScanUTF8(const uint8* data, size_t length)
+	{
+		size_t i = 0;
+		while (i < length) {
+			// skip ASCII a word at a time
+			if (fContinuation == 0 && i + sizeof(uint64) <= length) {
+				uint64 word;
+				memcpy(&word, data + i, sizeof(word));
+				if ((word & 0x8080808080808080ULL) == 0) {
+					i += sizeof(word);
+					continue;
+				}
+			}
+			const uint8 c = data[i++];
+			if (fContinuation > 0) {
+				if ((c & 0xC0) != 0x80) {
+					fValidUTF8 = false;
+					return;
+				}
+				fContinuation--;
+			} else if (c >= 0x80) {
+				if (c >= 0xC2 && c <= 0xDF)
+					fContinuation = 1;
+				else if (c >= 0xE0 && c <= 0xEF)
+					fContinuation = 2;
+				else if (c >= 0xF0 && c <= 0xF4)
+					fContinuation = 3;
+				else {
+					fValidUTF8 = false;
+					return;
+				}
+			}
+		}
+	}
+
+	int32	fEndOfLine;
+	bool	fPendingCR;
+	int32	fContinuation;
+	bool	fValidUTF8;
+};
+
+
+static size_t
+TeamMemoryUsage()
+{
+	size_t ramSize = 0;
+	ssize_t cookie = 0;
+	area_info info;
+	while (get_next_area_info(B_CURRENT_TEAM, &cookie, &info) == B_OK)
+		ramSize += info.ram_size;
+	return ramSize;
+}
+
+
+// Maps the file and passes it to 'consume' in chunks: Scintilla copies the
+// text straight into its buffer, without reading the whole file in memory
+// first. If 'memoryPeak' is given it's set to the memory used by the team
+// while both the mapping and the text are resident.
+static status_t
+ReadMapped(const entry_ref& ref, off_t size,
+	const std::function<bool(const char*, size_t)>& consume, size_t* memoryPeak)
+{
+	if (size == 0)
+		return B_OK;
+
+	BPath path(&ref);
+	int fd = open(path.Path(), O_RDONLY);
+	if (fd < 0)
+		return errno;
+
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+		return errno;
+	posix_madvise(mapped, size, POSIX_MADV_SEQUENTIAL);
+
+	status_t status = B_OK;
+	const char* data = static_cast<const char*>(mapped);
+	for (off_t offset = 0; offset < size; offset += kLoadChunkSize) {
+		const size_t length = std::min((off_t)kLoadChunkSize, size - offset);
+		if (!consume(data + offset, length)) {
+			status = B_NO_MEMORY;
+			break;
+		}
+	}
+
+	if (memoryPeak != nullptr)
+		*memoryPeak = TeamMemoryUsage();
+
+	munmap(mapped, size);
+	return status;
+}
+
+
 Editor::Editor(entry_ref* ref, const BMessenger& target)
 	:
 	BScintillaView(ref->name, 0, true, true)
@@ -72,6 +236,12 @@ Editor::Editor(entry_ref* ref, const BMessenger& target)
 	, fCurrentColumn(-1)
 	, fProjectFolder(NULL)
 	, fIdleHandler(nullptr)
+	, fTabManager(nullptr)
+	, fSaveThread(-1)
+	, fSaveText(nullptr)
+	, fSaveLength(0)
+	, fSaveStatus(B_OK)
+	, fBulkEdit(false)
 {
 	fStatusView = new editor::StatusView(this);
 	fFileName = BString(ref->name);
@@ -98,9 +268,6 @@ Editor::Editor(entry_ref* ref, const BMessenger& target)
 	SendMessage(SCI_SETMARGINMASKN, sci_FOLD_MARGIN, SC_MASK_FOLDERS);
 	SendMessage(SCI_SETMARGINSENSITIVEN, sci_FOLD_MARGIN, 1);
 
-	SendMessage(SCI_SETPROPERTY, (sptr_t) "fold", (sptr_t) "1");
-	SendMessage(SCI_SETPROPERTY, (sptr_t) "fold.comment", (sptr_t) "1");
-
 	SendMessage(SCI_SETMARGINTYPEN, sci_FOLD_MARGIN, SC_MARGIN_SYMBOL);
 	SendMessage(SCI_SETMARGINMASKN, sci_FOLD_MARGIN, SC_MASK_FOLDERS);
 	SendMessage(SCI_SETMARGINWIDTHN, sci_FOLD_MARGIN, 16);
@@ -147,6 +314,9 @@ Editor::HasLSPCapability(const LSPCapability cap) const
 
 Editor::~Editor()
 {
+	if (fSaveThread >= 0)
+		FinishSave();
+
 	// Stop monitoring
 	StopMonitoring();
 
@@ -329,6 +499,18 @@ Editor::MessageReceived(BMessage* message)
 			if (fLSPEditorWrapper)
 				fLSPEditorWrapper->ApplyFix(message);
 			break;
+		case kCodeActionsReceived:
+		{
+			EditorContextMenu::ShowPending(this);
+			// the Problems panel may be waiting too
+			BMessage received(kCodeActionsReceived);
+			received.AddPointer("editor", this);
+			Window()->PostMessage(&received);
+			break;
+		}
+		case kShowContextMenu:
+			EditorContextMenu::ShowPending(this);
+			break;
 		case kCallTipClick:
 		{
 			int32 position = message->GetInt32("position", 0);
@@ -485,22 +667,47 @@ Editor::TrimTrailingWhitespace()
 {
 	if ((gCFG["ignore_editorconfig"] && gCFG["trim_trailing_whitespace"])
 		|| fEditorConfig.TrimTrailingWhitespace) {
-		Sci::Guard<SearchTarget, SearchFlags> guard(this);
-
-		Sci_Position length = SendMessage(SCI_GETLENGTH, 0, 0);
-		Set<SearchTarget>({0, length});
-		Set<SearchFlags>(SCFIND_REGEXP | SCFIND_CXX11REGEX);
-
-		Sci::UndoAction action(this);
-		const std::string whitespace = "\\s+$";
-		int result;
-		do {
-			result = SendMessage(SCI_SEARCHINTARGET, whitespace.size(), (sptr_t)whitespace.c_str());
-			if (result != -1) {
-				SendMessage(SCI_REPLACETARGET, -1, (sptr_t)"");
-				Set<SearchTarget>({Get<SearchTargetEnd>(), length});
+		const bigtime_t start = system_time();
+
+		// the line ends are found in the buffer, then the whitespace
+		// before each one is looked for backwards
+		const char* text = (const char*)SendMessage(SCI_GETCHARACTERPOINTER);
+		const Sci_Position length = SendMessage(SCI_GETLENGTH);
+		const char eol = EndOfLine() == SC_EOL_CR ? '\r' : '\n';
+
+		// start, length of the whitespace to remove
+		std::vector<std::pair<Sci_Position, Sci_Position>> trims;
+		Sci_Position position = 0;
+		while (position <= length) {
+			const char* found = (const char*)memchr(text + position, eol, length - position);
+			const Sci_Position end = found != nullptr ? found - text : length;
+			Sci_Position lineEnd = end;
+			if (lineEnd > position && text[lineEnd - 1] == '\r')
+				lineEnd--;
+			Sci_Position trimStart = lineEnd;
+			while (trimStart > position && IsASpace(text[trimStart - 1])
+				&& text[trimStart - 1] != '\r' && text[trimStart - 1] != '\n') {
+				trimStart--;
 			}
-		} while(result != -1);
+			if (trimStart < lineEnd)
+				trims.push_back(std::make_pair(trimStart, lineEnd - trimStart));
+			position = end + 1;
+		}
+
+		if (!trims.empty()) {
+			Sci::UndoAction action(this);
+			fBulkEdit = true;
+			// back to front: the positions still to remove don't move
+			for (auto trim = trims.rbegin(); trim != trims.rend(); trim++)
+				SendMessage(SCI_DELETERANGE, trim->first, trim->second);
+			fBulkEdit = false;
+
+			fLSPEditorWrapper->CharAdded(0);
+			EvaluateIdleTime();
+		}
+
+		LogInfo("TrimTrailingWhitespace: %d lines trimmed in %" B_PRId64 " ms",
+			(int32)trims.size(), (system_time() - start) / 1000);
 	}
 }
 
@@ -662,47 +869,34 @@ Editor::FindInTarget(const BString& search, int flags, int startPosition, int en
 int32
 Editor::FindMarkAll(const BString& text, int flags)
 {
-	int position, count = 0;
-	int line, firstMark;
+	const bigtime_t start = system_time();
 
 	// Clear all
 	BookmarkClearAll(sci_BOOKMARK);
 
 	// TODO use wrap
-	SendMessage(SCI_TARGETWHOLEDOCUMENT, UNSET, UNSET);
-	SendMessage(SCI_SETSEARCHFLAGS, flags, UNSET);
-	position = SendMessage(SCI_SEARCHINTARGET, text.Length(), (sptr_t) text.String());
-	firstMark = position;
-
-	if (position == -1)
+	std::vector<std::pair<Sci_Position, Sci_Position>> hits;
+	_FindAll(text, flags, hits);
+	if (hits.empty())
 		// No occurrence found
 		return 0;
-	else
-		SendMessage(SCI_GOTOPOS, position, UNSET);
-
-	while (position != -1) {
-		SendMessage(SCI_SEARCHANCHOR, 0, 0);
-		position = SendMessage(SCI_SEARCHNEXT, flags, (sptr_t) text.String());
 
-		if (position == -1)
-			break;
-		else {
-			// Get line
-			line = SendMessage(SCI_LINEFROMPOSITION, position, UNSET);
-			SendMessage(SCI_MARKERADD, line, sci_BOOKMARK);
-			SendMessage(SCI_CHARRIGHT, UNSET, UNSET);
-			count++;
-
-			// Found occurrence, message window
-			BMessage message(EDITOR_FIND_SET_MARK);
-			message.AddRef("ref", &fFileRef);
-			int line = SendMessage(SCI_LINEFROMPOSITION, position, UNSET) + 1;
-			message.AddInt32("line", line);
-			fTarget.SendMessage(&message);
-		}
+	int32 lines = 0;
+	Sci_Position lastLine = -1;
+	for (const auto& hit : hits) {
+		const Sci_Position line = SendMessage(SCI_LINEFROMPOSITION, hit.first, UNSET);
+		if (line == lastLine)
+			continue;
+		SendMessage(SCI_MARKERADD, line, sci_BOOKMARK);
+		lastLine = line;
+		lines++;
 	}
+	SendMessage(SCI_GOTOPOS, hits[0].first, UNSET);
+
+	const int32 count = hits.size();
+	LogInfo("FindMarkAll: %d occurrences on %d lines in %" B_PRId64 " ms", count, lines,
+		(system_time() - start) / 1000);
 
-	SendMessage(SCI_GOTOPOS, firstMark, UNSET);
 	BMessage message(EDITOR_FIND_COUNT);
 	message.AddString("text_to_find", text);
 	message.AddInt32("count", count);
@@ -712,6 +906,28 @@ Editor::FindMarkAll(const BString& text, int flags)
 }
 
 
+void
+Editor::_FindAll(const BString& text, int flags,
+	std::vector<std::pair<Sci_Position, Sci_Position>>& hits)
+{
+	// one pass on the document: neither the caret nor the selection move
+	const Sci_Position length = SendMessage(SCI_GETLENGTH);
+	SendMessage(SCI_SETSEARCHFLAGS, flags, UNSET);
+
+	Sci_Position position = 0;
+	while (position <= length) {
+		SendMessage(SCI_SETTARGETRANGE, position, length);
+		const Sci_Position found = SendMessage(SCI_SEARCHINTARGET, text.Length(),
+			(sptr_t) text.String());
+		if (found == -1)
+			break;
+		const Sci_Position end = SendMessage(SCI_GETTARGETEND);
+		hits.push_back(std::make_pair(found, end));
+		position = end > found ? end : found + 1;
+	}
+}
+
+
 int
 Editor::FindNext(const BString& search, int flags, bool wrap)
 {
@@ -843,60 +1059,47 @@ Editor::LoadEditorConfig()
 	if ((bool)gCFG["ignore_editorconfig"])
 		return;
 
-	// start parsing
-	// Ignore full path error, whose error code is EDITORCONFIG_PARSE_NOT_FULL_PATH
-	editorconfig_handle handle = editorconfig_handle_init();
-	if (handle == nullptr)
-		return;
-
-	int errNum;
-	if ((errNum = editorconfig_parse(FilePath().String(), handle)) != 0 &&
-			errNum != EDITORCONFIG_PARSE_NOT_FULL_PATH) {
-		LogError("Can't load .editorconfig with error %d", editorconfig_get_error_msg(errNum));
-	} else {
-		int32 nameValueCount = editorconfig_handle_get_name_value_count(handle);
-		if (nameValueCount != 0)
-			fHasEditorConfig = true;
-
-		/* get settings */
-		// Defaults. TODO: This avoids the compiler error
-		// but maybe the code should be refactored
-		int32 tabWidth = 4;
-		for (int32 i = 0; i < nameValueCount; ++i) {
-			const char* name;
-			const char* value;
-			editorconfig_handle_get_name_value(handle, i, &name, &value);
-
-			if (!strcmp(name, "indent_style")) {
-				fEditorConfig.IndentStyle = !strcmp(value, "space") ? IndentStyle::Space : IndentStyle::Tab;
-			} else if (!strcmp(name, "tab_width")) {
-				if (strcmp(value, "undefine"))
-					tabWidth = atoi(value);
-			} else if (!strcmp(name, "indent_size")) {
-				if (strcmp(value, "undefine")) {
-					int valueInt = atoi(value);
-					if (!strcmp(value, "tab"))
-						fEditorConfig.IndentSize = tabWidth;
-					else if (valueInt > 0)
-						fEditorConfig.IndentSize = valueInt;
-				}
-			} else if (!strcmp(name, "end_of_line")) {
-				if (strcmp(value, "undefine")) {
-					if (!strcmp(value, "lf"))
-						fEditorConfig.EndOfLine = SC_EOL_LF;
-					else if (!strcmp(value, "cr"))
-						fEditorConfig.EndOfLine = SC_EOL_CR;
-					else if (!strcmp(value, "crlf"))
-						fEditorConfig.EndOfLine = SC_EOL_CRLF;
-				}
-			} else if (!strcmp(name, "trim_trailing_whitespace")) {
-				if (strcmp(value, "undefine"))
-					fEditorConfig.TrimTrailingWhitespace = !strcmp(value, "true") ? true : false;
-			} else if (!strcmp(name, "insert_final_newline"))
-				fEditorConfig.InsertFinalNewline = !strcmp(value, "true") ? true : false;
-		}
+	EditorConfigCache::Properties properties;
+	EditorConfigCache::Resolve(FilePath().String(), properties);
+	if (!properties.empty())
+		fHasEditorConfig = true;
+
+	/* get settings */
+	// Defaults. TODO: This avoids the compiler error
+	// but maybe the code should be refactored
+	int32 tabWidth = 4;
+	for (const auto& property : properties) {
+		const char* name = property.first.c_str();
+		const char* value = property.second.c_str();
+
+		if (!strcmp(name, "indent_style")) {
+			fEditorConfig.IndentStyle = !strcmp(value, "space") ? IndentStyle::Space : IndentStyle::Tab;
+		} else if (!strcmp(name, "tab_width")) {
+			if (strcmp(value, "undefine"))
+				tabWidth = atoi(value);
+		} else if (!strcmp(name, "indent_size")) {
+			if (strcmp(value, "undefine")) {
+				int valueInt = atoi(value);
+				if (!strcmp(value, "tab"))
+					fEditorConfig.IndentSize = tabWidth;
+				else if (valueInt > 0)
+					fEditorConfig.IndentSize = valueInt;
+			}
+		} else if (!strcmp(name, "end_of_line")) {
+			if (strcmp(value, "undefine")) {
+				if (!strcmp(value, "lf"))
+					fEditorConfig.EndOfLine = SC_EOL_LF;
+				else if (!strcmp(value, "cr"))
+					fEditorConfig.EndOfLine = SC_EOL_CR;
+				else if (!strcmp(value, "crlf"))
+					fEditorConfig.EndOfLine = SC_EOL_CRLF;
+			}
+		} else if (!strcmp(name, "trim_trailing_whitespace")) {
+			if (strcmp(value, "undefine"))
+				fEditorConfig.TrimTrailingWhitespace = !strcmp(value, "true") ? true : false;
+		} else if (!strcmp(name, "insert_final_newline"))
+			fEditorConfig.InsertFinalNewline = !strcmp(value, "true") ? true : false;
 	}
-	editorconfig_handle_destroy(handle);
 }
 
 
@@ -927,22 +1130,47 @@ Editor::LoadFromFile()
 	off_t size;
 	file.GetSize(&size);
 
-	char* buffer = new char[size + 1];
-	off_t len = file.Read(buffer, size);
-	buffer[size] = '\0';
+	const bigtime_t start = system_time();
+	const bool largeFile = size >= kLargeFileSize;
+	const size_t memoryBefore = largeFile ? TeamMemoryUsage() : 0;
+	size_t memoryPeak = 0;
+
+	// The file is loaded in a new document, not yet attached to the view,
+	// so no notification is sent and no undo history is kept while loading
+	Sci::ILoader* loader = reinterpret_cast<Sci::ILoader*>(SendMessage(SCI_CREATELOADER,
+		size, size > INT32_MAX ? SC_DOCUMENTOPTION_TEXT_LARGE : SC_DOCUMENTOPTION_DEFAULT));
+	if (loader == nullptr)
+		return B_NO_MEMORY;
+
+	LoadScanner scanner;
+	status = ReadMapped(fFileRef, size, [&](const char* data, size_t length) {
+		scanner.Scan(data, length);
+		return loader->AddData(data, length) == SC_STATUS_OK;
+	}, largeFile ? &memoryPeak : nullptr);
+	if (status != B_OK) {
+		loader->Release();
+		return status;
+	}
 
-	SendMessage(SCI_SETTEXT, 0, (sptr_t) buffer);
+	sptr_t document = reinterpret_cast<sptr_t>(loader->ConvertToDocument());
+	SendMessage(SCI_SETDOCPOINTER, UNUSED, document);
+	SendMessage(SCI_RELEASEDOCUMENT, UNUSED, document);
+	SendMessage(SCI_SETUNDOCOLLECTION, 1, UNSET);
 
-	// Check the first newline only
-	int32 lineLength = SendMessage(SCI_LINELENGTH, 0, UNSET);
-	char *lineBuffer = new char[lineLength];
-	SendMessage(SCI_GETLINE, 0, (sptr_t)lineBuffer);
-	_EndOfLineAssign(lineBuffer, lineLength);
-	delete[] lineBuffer;
-	delete[] buffer;
+	// Properties belong to the document
+	SendMessage(SCI_SETPROPERTY, (sptr_t) "fold", (sptr_t) "1");
+	SendMessage(SCI_SETPROPERTY, (sptr_t) "fold.comment", (sptr_t) "1");
 
-	if (len != size)
-		return B_ERROR;
+	SendMessage(SCI_SETEOLMODE, scanner.EndOfLine(), UNSET);
+
+	if (!scanner.IsValidUTF8())
+		LogInfo("%s is not valid UTF-8 text", fFileName.String());
+
+	if (largeFile) {
+		LogInfo("Loaded %s: %" B_PRIdOFF " MiB in %" B_PRId64 " ms, memory peak +%" B_PRIuSIZE " MiB",
+			fFileName.String(), size / (1024 * 1024), (system_time() - start) / 1000,
+			(memoryPeak - std::min(memoryBefore, memoryPeak)) / (1024 * 1024));
+	}
 
 	if ((status = file.Unlock()) != B_OK)
 		return status;
@@ -1011,14 +1239,20 @@ Editor::NotificationReceived(SCNotification* notification)
 			fLSPEditorWrapper->SelectedCompletion(notification->text);
 			break;
 		}
+		case SCN_AUTOCCHARDELETED:
+			fLSPEditorWrapper->UpdateCompletion();
+			break;
 		case SCN_MODIFIED: {
 			if (notification->modificationType & SC_MOD_INSERTTEXT) {
 				fLSPEditorWrapper->didChange(notification->text, notification->length, notification->position, 0);
-				EvaluateIdleTime();
+				if (!fBulkEdit)
+					EvaluateIdleTime();
 			}
 			if (notification->modificationType & SC_MOD_BEFOREDELETE) {
 				fLSPEditorWrapper->didChange("", 0, notification->position, notification->length);
 			}
+			if (fBulkEdit)
+				break;
 			if (notification->modificationType & SC_MOD_DELETETEXT) {
 					fLSPEditorWrapper->CharAdded(0);
 					EvaluateIdleTime();
@@ -1168,18 +1402,22 @@ Editor::Reload()
 	off_t size;
 	file.GetSize(&size);
 
-	char* buffer = new char[size + 1];
-	off_t len = file.Read(buffer, size);
-	buffer[size] = '\0';
+	// The document is kept (lexer, bookmarks) and refilled with the mapped
+	// file; the old text isn't needed in the undo history
+	SendMessage(SCI_SETUNDOCOLLECTION, 0, UNSET);
 	SendMessage(SCI_CLEARALL, UNSET, UNSET);
-	SendMessage(SCI_SETTEXT, 0, (sptr_t) buffer);
-	delete[] buffer;
+	SendMessage(SCI_ALLOCATE, size, UNSET);
+	status = ReadMapped(fFileRef, size, [&](const char* data, size_t length) {
+		SendMessage(SCI_APPENDTEXT, length, (sptr_t) data);
+		return true;
+	}, nullptr);
+	SendMessage(SCI_SETUNDOCOLLECTION, 1, UNSET);
 
 	if (readOnly == true)
 		SendMessage(SCI_SETREADONLY, 1, UNSET);
 
-	if (len != size)
-		return B_ERROR;
+	if (status != B_OK)
+		return status;
 
 	if ((status = file.Unlock()) != B_OK)
 		return status;
@@ -1239,31 +1477,35 @@ Editor::ReplaceAndFindPrevious(const BString& selection,
 int32
 Editor::ReplaceAll(const BString& selection, const BString& replacement, int flags)
 {
-	int32 count = 0;
+	const bigtime_t start = system_time();
 
-	SendMessage(SCI_TARGETWHOLEDOCUMENT, UNSET, UNSET);
-	SendMessage(SCI_SETSEARCHFLAGS, flags, UNSET);
-
-	int position;
-	int endPosition = SendMessage(SCI_GETTARGETEND, 0, 0);
+	std::vector<std::pair<Sci_Position, Sci_Position>> hits;
+	_FindAll(selection, flags, hits);
 
-	SendMessage(SCI_BEGINUNDOACTION, 0, 0);
+	if (!hits.empty()) {
+		SendMessage(SCI_BEGINUNDOACTION, 0, 0);
+		fBulkEdit = true;
 
-	do {
-		position = SendMessage(SCI_SEARCHINTARGET, selection.Length(),
-												(sptr_t) selection.String());
-		if (position != -1) {
-			SendMessage(SCI_REPLACETARGET, -1, (sptr_t) replacement.String());
-			count++;
+		// the hits after a replacement are moved by the length difference
+		Sci_Position delta = 0;
+		for (const auto& hit : hits) {
+			SendMessage(SCI_SETTARGETRANGE, hit.first + delta, hit.second + delta);
+			const Sci_Position length = SendMessage(SCI_REPLACETARGET, replacement.Length(),
+				(sptr_t) replacement.String());
+			delta += length - (hit.second - hit.first);
+		}
 
-			// Found occurrence, message window
-			ReplaceMessage(position, selection, replacement);
+		fBulkEdit = false;
+		SendMessage(SCI_ENDUNDOACTION, 0, 0);
 
-			SendMessage(SCI_SETTARGETRANGE, position + replacement.Length(), endPosition);
-		}
-	} while (position != -1);
+		fLSPEditorWrapper->CharAdded(0);
+		EvaluateIdleTime();
+		_RedrawNumberMargin(false);
+	}
 
-	SendMessage(SCI_ENDUNDOACTION, 0, 0);
+	const int32 count = hits.size();
+	LogInfo("ReplaceAll: %d replacements in %" B_PRId64 " ms", count,
+		(system_time() - start) / 1000);
 
 	BMessage message(EDITOR_REPLACE_ALL_COUNT);
 	message.AddInt32("count", count);
@@ -1308,38 +1550,137 @@ Editor::ReplaceOne(const BString& selection, const BString& replacement)
 status_t
 Editor::SaveToFile()
 {
-	BFile file;
-	status_t status = file.SetTo(&fFileRef, B_READ_WRITE | B_ERASE_FILE | B_CREATE_FILE);
+	status_t status = StartSave();
 	if (status != B_OK)
 		return status;
+	return FinishSave();
+}
 
-	if ((status = file.Lock()) != B_OK)
-		return status;
-
-	off_t size = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
-	file.Seek(0, SEEK_SET);
-	char* buffer = new char[size + 1];
 
-	SendMessage(SCI_GETTEXT, size + 1, (sptr_t)buffer);
+status_t
+Editor::StartSave()
+{
+	if (fSaveThread >= 0)
+		return B_BUSY;
+
+	// The text is written straight from the Scintilla buffer, which stays
+	// valid as long as the document isn't modified
+	fSaveLength = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
+	fSaveText = reinterpret_cast<const char*>(
+		SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+	fSaveStatus = B_OK;
+
+	fSaveThread = spawn_thread(_SaveThread, "Editor save", B_NORMAL_PRIORITY, this);
+	if (fSaveThread < 0) {
+		fSaveStatus = _WriteFile();
+		return B_OK;
+	}
+	resume_thread(fSaveThread);
+	return B_OK;
+}
 
-	off_t bytes = file.Write(buffer, size);
-	file.Flush();
-	delete[] buffer;
 
-	if ((status = file.Unlock()) != B_OK)
-		return status;
+status_t
+Editor::FinishSave()
+{
+	if (fSaveThread >= 0) {
+		status_t exitValue;
+		wait_for_thread(fSaveThread, &exitValue);
+		fSaveThread = -1;
+	}
+	fSaveText = nullptr;
 
-	if (bytes != size)
-		return B_ERROR;
+	if (fSaveStatus != B_OK)
+		return fSaveStatus;
 
 	SendMessage(SCI_SETSAVEPOINT, UNSET, UNSET);
 
+	// the folder is not monitored when outside of the projects
+	if (fFileName == ".editorconfig")
+		EditorConfigCache::Invalidate(FilePath().String());
+
 	fLSPEditorWrapper->didSave();
 
 	return B_OK;
 }
 
 
+/* static */
+status_t
+Editor::_SaveThread(void* cookie)
+{
+	Editor* editor = static_cast<Editor*>(cookie);
+	editor->fSaveStatus = editor->_WriteFile();
+	return B_OK;
+}
+
+
+status_t
+Editor::_WriteFile() const
+{
+	// symbolic links are kept, the file they point to is written
+	BEntry entry(&fFileRef, true);
+	BPath path;
+	status_t status = entry.GetPath(&path);
+	if (status != B_OK)
+		return status;
+
+	// An existing file is replaced by a temporary one only when this has
+	// been written completely, so a failure never leaves it truncated.
+	// New files, or files in folders where the temporary one can't be
+	// created, are written in place.
+	BString tempPath;
+	int fd = -1;
+	struct stat st;
+	if (entry.GetStat(&st) == B_OK) {
+		BPath parent;
+		path.GetParent(&parent);
+		tempPath.SetToFormat("%s/.%s%s", parent.Path(), path.Leaf(),
+			GenioNames::kSaveTempSuffix.String());
+		fd = open(tempPath.String(), O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 07777);
+		if (fd < 0)
+			tempPath = "";
+		else if (fchmod(fd, st.st_mode & 07777) != 0 || fchown(fd, st.st_uid, st.st_gid) != 0)
+			LogTrace("Can't keep the permissions of %s", path.Path());
+	}
+	if (fd < 0)
+		fd = open(path.Path(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		return errno;
+
+	size_t written = 0;
+	while (written < fSaveLength) {
+		ssize_t bytes = write(fd, fSaveText + written, fSaveLength - written);
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+			status = errno;
+			break;
+		}
+		written += bytes;
+	}
+	if (status == B_OK && fsync(fd) != 0)
+		status = errno;
+	if (close(fd) != 0 && status == B_OK)
+		status = errno;
+
+	if (tempPath.IsEmpty())
+		return status;
+
+	if (status == B_OK) {
+		// file type, caret position and the other attributes
+		BEntry tempEntry(tempPath.String());
+		FSCopyAttributes(&entry, &tempEntry);
+		if (rename(tempPath.String(), path.Path()) != 0)
+			status = errno;
+	}
+	if (status != B_OK)
+		unlink(tempPath.String());
+
+	return status;
+}
+
+
 void
 Editor::ScrollCaret()
 {
@@ -1484,6 +1825,8 @@ Editor::SetFileRef(entry_ref* ref)
 
 	fFileRef = *ref;
 	fFileName = BString(fFileRef.name);
+	if (fTabManager != nullptr)
+		fTabManager->EditorChanged(this);
 
 	UpdateStatusBar();
 	return B_OK;
@@ -1584,6 +1927,9 @@ Editor::StartMonitoring()
 		LogErrorF("Can't get a node_ref! (%s) (%s)", fFileRef.name, strerror(status));
 		return status;
 	}
+	// the node changes when the file is replaced, i.e. when saved
+	if (fTabManager != nullptr)
+		fTabManager->EditorChanged(this);
 	if ((status = watch_node(&fNodeRef, B_WATCH_NAME | B_WATCH_STAT, fTarget)) != B_OK) {
 		LogErrorF("Can't start watch_node a node_ref! (%s) (%s)", fFileRef.name, strerror(status));
 		return status;
@@ -1973,35 +2319,6 @@ Editor::EndOfLine()
 }
 
 
-void
-Editor::_EndOfLineAssign(char *buffer, int32 size)
-{
-	// Empty file, use default LF
-	if (size == 0) {
-		SendMessage(SCI_SETEOLMODE, SC_EOL_LF, UNSET);
-		return;
-	}
-
-	int32 eol;
-	switch (buffer[size - 1]) {
-		case '\n':
-			if (size > 1 && buffer[size - 2] == '\r')
-				eol = SC_EOL_CRLF;
-			else
-				eol = SC_EOL_LF;
-			break;
-		case '\r':
-			eol = SC_EOL_CR;
-			break;
-		default:
-			eol = SC_EOL_LF;
-			break;
-	}
-
-	SendMessage(SCI_SETEOLMODE, eol, UNSET);
-}
-
-
 void
 Editor::_HighlightBraces()
 {
@@ -2115,14 +2432,16 @@ Editor::GetDocumentSymbols(BMessage* symbols) const
 void
 Editor::EvaluateIdleTime()
 {
-	if (fIdleHandler == nullptr || fIdleHandler->SetInterval(kIdleTimeout) != B_OK) {
+	// the LSP wrapper may shorten the delay to bound the latency of pending changes
+	bigtime_t timeout = fLSPEditorWrapper->FlushDelay(kIdleTimeout);
+	if (fIdleHandler == nullptr || fIdleHandler->SetInterval(timeout) != B_OK) {
 		LogInfo("EvaluateIdleTime: Re-arming IdleHandler...");
 		if (fIdleHandler != nullptr)
 			delete fIdleHandler;
 
 		// create a message to update the project
 		BMessage message(kIdle);
-		fIdleHandler = new BMessageRunner(BMessenger(this), &message, kIdleTimeout, 1);
+		fIdleHandler = new BMessageRunner(BMessenger(this), &message, timeout, 1);
 		if (fIdleHandler->InitCheck() != B_OK) {
 			LogInfo("EvaluateIdleTime: Could not create fIdleHandler. Deleting it");
 			if (fIdleHandler != nullptr) {
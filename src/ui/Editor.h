@@ -14,10 +14,12 @@
 #include <MessageRunner.h>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "LSPCapabilities.h"
 
 
+class EditorTabManager;
 class LSPEditorWrapper;
 class ProjectFolder;
 
@@ -29,7 +31,6 @@ enum {
 	EDITOR_FIND_COUNT				= 'Efco',
 	EDITOR_FIND_NEXT_MISS			= 'Efnm',
 	EDITOR_FIND_PREV_MISS			= 'Efpm',
-	EDITOR_FIND_SET_MARK			= 'Efsm',
 	EDITOR_POSITION_CHANGED			= 'Epch',
 	EDITOR_REPLACE_ONE				= 'Eron',
 	EDITOR_REPLACE_ALL_COUNT		= 'Erac',
@@ -122,6 +123,11 @@ public:
 			bool				IsOverwrite();
 
 			status_t			SaveToFile();
+			// SaveToFile() in two steps, so several editors can write their
+			// files at the same time. The document must not be modified
+			// until FinishSave() is called.
+			status_t			StartSave();
+			status_t			FinishSave();
 			status_t			SetFileRef(entry_ref* ref);
 			void				SetReadOnly(bool readOnly = true);
 			status_t			SetSavedCaretPosition();
@@ -129,6 +135,8 @@ public:
 			status_t			StartMonitoring();
 			status_t			StopMonitoring();
 
+			void				SetTabManager(EditorTabManager* manager) { fTabManager = manager; }
+
 			void				SetProjectFolder(ProjectFolder*);
 			ProjectFolder*		GetProjectFolder() const { return fProjectFolder; }
 			void				Undo();
@@ -163,6 +171,9 @@ public:
 
 private:
 
+	static	status_t			_SaveThread(void* cookie);
+			status_t			_WriteFile() const;
+
 			int					ReplaceAndFindNext(const BString& selection,
 									const BString& replacement, int flags, bool wrap);
 			int					ReplaceAndFindPrevious(const BString& selection,
@@ -176,6 +187,8 @@ private:
 			int					SetSearchFlags(bool matchCase, bool wholeWord,
 									bool wordStart,	bool regExp, bool posix);
 			int32				FindMarkAll(const BString& text, int flags);
+			void				_FindAll(const BString& text, int flags,
+									std::vector<std::pair<Sci_Position, Sci_Position>>& hits);
 			int					FindNext(const BString& search, int flags, bool wrap);
 			int					FindPrevious(const BString& search, int flags, bool wrap);
 			int					FindInTarget(const BString& search, int flags, int startPosition, int endPosition);
@@ -228,7 +241,6 @@ private:
 			void				_BraceHighlight();
 			bool				_BraceMatch(int pos);
 			void				_CommentLine(int32 position);
-			void				_EndOfLineAssign(char *buffer, int32 size);
 			void				_HighlightBraces();
 			void				_RedrawNumberMargin(bool forced = false);
 			void				_SetFoldMargin(bool enabled);
@@ -274,6 +286,16 @@ private:
 			EditorConfig		fEditorConfig;
 
 			BMessageRunner*		fIdleHandler;
+			EditorTabManager*	fTabManager;
+
+			thread_id			fSaveThread;
+			const char*			fSaveText;
+			size_t				fSaveLength;
+			status_t			fSaveStatus;
+
+			// many modifications in a row (ReplaceAll): the work done
+			// for each one is done once at the end
+			bool				fBulkEdit;
 };
 
 #endif // EDITOR_H
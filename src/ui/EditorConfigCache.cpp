@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+
+#include "EditorConfigCache.h"
+
+#include <Autolock.h>
+#include <editorconfig/editorconfig.h>
+
+#include "Log.h"
+
+static const char* kFileName = ".editorconfig";
+
+
+static void
+SplitPath(const std::string& path, std::string& folder, std::string& name)
+{
+	const size_t slash = path.rfind('/');
+	if (slash == std::string::npos) {
+		folder = "";
+		name = path;
+		return;
+	}
+	folder = slash == 0 ? "/" : path.substr(0, slash);
+	name = path.substr(slash + 1);
+}
+
+
+EditorConfigCache EditorConfigCache::sInstance;
+
+
+EditorConfigCache::EditorConfigCache()
+	:
+	fLock("EditorConfigCache")
+{
+}
+
+
+/* static */
+void
+EditorConfigCache::Resolve(const char* path, Properties& properties)
+{
+	std::string folder, name;
+	SplitPath(path, folder, name);
+
+	BAutolock lock(sInstance.fLock);
+	Folder& files = sInstance.fFolders[folder];
+	auto found = files.find(name);
+	if (found == files.end()) {
+		const bigtime_t start = system_time();
+		found = files.emplace(name, Properties()).first;
+		_Parse(path, found->second);
+		LogTrace("EditorConfigCache: %s resolved in %" B_PRId64 " us", path,
+			system_time() - start);
+	}
+	properties = found->second;
+}
+
+
+/* static */
+void
+EditorConfigCache::Invalidate(const char* path)
+{
+	std::string changed(path);
+	std::string folder, name;
+	SplitPath(changed, folder, name);
+
+	BAutolock lock(sInstance.fLock);
+
+	// a .editorconfig: every file in its folder and below
+	if (name == kFileName)
+		changed = folder;
+	else {
+		auto files = sInstance.fFolders.find(folder);
+		if (files != sInstance.fFolders.end())
+			files->second.erase(name);
+	}
+
+	// a folder: the folders inside it too
+	sInstance.fFolders.erase(changed);
+	const std::string prefix = changed == "/" ? changed : changed + "/";
+	auto found = sInstance.fFolders.lower_bound(prefix);
+	while (found != sInstance.fFolders.end()
+		&& found->first.compare(0, prefix.length(), prefix) == 0) {
+		found = sInstance.fFolders.erase(found);
+	}
+}
+
+
+/* static */
+void
+EditorConfigCache::Clear()
+{
+	BAutolock lock(sInstance.fLock);
+	sInstance.fFolders.clear();
+}
+
+
+/* static */
+void
+EditorConfigCache::_Parse(const char* path, Properties& properties)
+{
+	editorconfig_handle handle = editorconfig_handle_init();
+	if (handle == nullptr)
+		return;
+
+	// Ignore full path error, whose error code is EDITORCONFIG_PARSE_NOT_FULL_PATH
+	int errNum;
+	if ((errNum = editorconfig_parse(path, handle)) != 0 &&
+			errNum != EDITORCONFIG_PARSE_NOT_FULL_PATH) {
+		LogError("Can't load .editorconfig for %s: %s", path,
+			editorconfig_get_error_msg(errNum));
+	} else {
+		const int count = editorconfig_handle_get_name_value_count(handle);
+		for (int i = 0; i < count; i++) {
+			const char* name;
+			const char* value;
+			editorconfig_handle_get_name_value(handle, i, &name, &value);
+			properties.push_back(std::make_pair(name, value));
+		}
+	}
+	editorconfig_handle_destroy(handle);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2024, Andrea Anzani <andrea.anzani@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#pragma once
+
+#include <Locker.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Caches the EditorConfig (https://editorconfig.org) properties resolved by
+// the editorconfig core library, grouped by the folder of the files: opening
+// a file again doesn't read again the .editorconfig files of its folder and
+// of the ones above. The properties are resolved again after Invalidate()
+// or Clear().
+
+class EditorConfigCache {
+public:
+	typedef std::vector<std::pair<std::string, std::string>> Properties;
+
+	EditorConfigCache(EditorConfigCache const&) = delete;
+	void operator=(EditorConfigCache const&) = delete;
+
+	// 'path' must be absolute
+	static void		Resolve(const char* path, Properties& properties);
+
+	// 'path' was created, removed, moved or saved
+	static void		Invalidate(const char* path);
+	static void		Clear();
+
+private:
+	// the properties of each file name of a folder
+	typedef std::map<std::string, Properties> Folder;
+
+						EditorConfigCache();
+
+	static	void		_Parse(const char* path, Properties& properties);
+
+	BLocker							fLock;
+	std::map<std::string, Folder>	fFolders;
+
+	static EditorConfigCache		sInstance;
+};
@@ -9,6 +9,7 @@
 #include <Autolock.h>
 #include <Catalog.h>
 #include <MenuItem.h>
+#include <MessageRunner.h>
 #include <PopUpMenu.h>
 
 #include "ActionManager.h"
@@ -24,6 +25,8 @@
 
 BPopUpMenu* EditorContextMenu::sMenu = nullptr;
 BPopUpMenu* EditorContextMenu::sFixMenu = nullptr;
+Editor* EditorContextMenu::sPendingEditor = nullptr;
+BPoint EditorContextMenu::sPendingPoint;
 
 
 EditorContextMenu::EditorContextMenu()
@@ -75,7 +78,7 @@ EditorContextMenu::_CreateMenu()
 
 
 void
-EditorContextMenu::Show(Editor* editor, BPoint point)
+EditorContextMenu::Show(Editor* editor, BPoint point, bool waitFixes)
 {
 	BAutolock l(editor->Looper());
 
@@ -92,12 +95,22 @@ EditorContextMenu::Show(Editor* editor, BPoint point)
 	// from the window.
 	menu->SetTargetForItems((BHandler*)editor->Window());
 
+	sPendingEditor = nullptr;
 	LSPEditorWrapper* lsp = editor->GetLSPEditorWrapper();
 	if (lsp != nullptr) {
 		LSPDiagnostic dia;
 		BPoint p = editor->ConvertFromScreen(point);
 		Sci_Position sci_position = editor->SendMessage(SCI_POSITIONFROMPOINT, p.x, p.y);
 		int32 index = lsp->DiagnosticFromPosition(sci_position, dia);
+		// the fixes are asked to the server only now: the menu is shown when
+		// they arrive, as the response is handled by this same looper
+		if (lsp->RequestCodeActions(index) && waitFixes) {
+			sPendingEditor = editor;
+			sPendingPoint = point;
+			BMessage timeout(kShowContextMenu);
+			BMessageRunner::StartSending(BMessenger(editor), &timeout, kFixesTimeout, 1);
+			return;
+		}
 		if (index > -1 && dia.diagnostic.codeActions.value().size() > 0) {
 			sFixMenu->RemoveItems(0, sFixMenu->CountItems(), true);
 			std::vector<CodeAction> actions = dia.diagnostic.codeActions.value();
@@ -128,3 +141,13 @@ EditorContextMenu::Show(Editor* editor, BPoint point)
 
 	ActionManager::SetEnabled(MSG_FIND_IN_BROWSER, isFindInBrowserEnable);
 }
+
+
+void
+EditorContextMenu::ShowPending(Editor* editor)
+{
+	if (sPendingEditor != editor)
+		return;
+	sPendingEditor = nullptr;
+	Show(editor, sPendingPoint, false);
+}
@@ -15,13 +15,20 @@ class BMenuItem;
 
 class EditorContextMenu {
 public:
-	static void Show(Editor*, BPoint point);
+	// how long a menu waits for the fixes of the problem clicked
+	static constexpr bigtime_t kFixesTimeout = 300000;
+
+	static void Show(Editor*, BPoint point, bool waitFixes = true);
+	// the fixes asked by Show() arrived, or it's too late to wait for them
+	static void ShowPending(Editor*);
 
 private:
 		   EditorContextMenu();
 
 	static BPopUpMenu*	sMenu;
 	static BPopUpMenu*	sFixMenu;
+	static Editor*		sPendingEditor;
+	static BPoint		sPendingPoint;
 	static void _CreateMenu();
 
 };
@@ -11,7 +11,10 @@ enum {
 	kClassOutline		= 'ClsO',
 	kCallTipClick		= 'Ctck',
 	kIdle				= 'IDLE',
-	kCheckEntryRemoved  = 'ENRE'
+	kCheckEntryRemoved  = 'ENRE',
+	kFlushNodeMonitor	= 'FLNM',
+	kCodeActionsReceived	= 'CdAR',
+	kShowContextMenu	= 'ShCM'
 };
 
 
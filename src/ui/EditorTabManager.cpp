@@ -13,6 +13,8 @@
 #include "ActionManager.h"
 #include "GenioWindowMessages.h"
 #include <Catalog.h>
+#include <Entry.h>
+#include <Path.h>
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "EditorTabManager"
@@ -59,43 +61,96 @@ EditorTabManager::SelectedEditor() const
 Editor*
 EditorTabManager::EditorBy(const entry_ref* ref) const
 {
-	BEntry entry(ref, true);
-	int32 filesCount = CountTabs();
-	for (int32 index = 0; index < filesCount; index++) {
-		Editor* editor = EditorAt(index);
-		if (editor == nullptr) {
-			BString notification;
-			notification
-				<< "Index " << index << ": NULL editor pointer";
-			LogInfo(notification.String());
-			continue;
-		}
-
-		BEntry matchEntry(editor->FileRef(), true);
-		if (matchEntry == entry)
-			return editor;
-	}
-	return nullptr;
+	auto found = fEditorsByRef.find(_ResolvedRef(ref));
+	if (found == fEditorsByRef.end())
+		return nullptr;
+	return found->second;
 }
 
 
 Editor*
 EditorTabManager::EditorBy(const node_ref* nodeRef) const
 {
-	int32 filesCount = CountTabs();
-	for (int32 index = 0; index < filesCount; index++) {
-		Editor* editor = EditorAt(index);
-		if (editor == nullptr) {
-			BString notification;
-			notification
-				<< "Index " << index << ": NULL editor pointer";
-			LogInfo(notification.String());
-			continue;
-		}
-		if (editor->NodeRef() != nullptr && *editor->NodeRef() == *nodeRef)
-			return editor;
+	auto found = fEditorsByNode.find(*nodeRef);
+	if (found == fEditorsByNode.end())
+		return nullptr;
+	return found->second;
+}
+
+
+void
+EditorTabManager::AddTab(Editor* editor, const char* label, int32 index,
+	BMessage* addInfo)
+{
+	editor->SetTabManager(this);
+	_Index(editor);
+	TabManager::AddTab(editor, label, index, addInfo);
+}
+
+
+BView*
+EditorTabManager::RemoveTab(int32 index)
+{
+	Editor* editor = EditorAt(index);
+	if (editor != nullptr) {
+		_Unindex(editor);
+		editor->SetTabManager(nullptr);
 	}
-	return nullptr;
+	return TabManager::RemoveTab(index);
+}
+
+
+void
+EditorTabManager::EditorChanged(Editor* editor)
+{
+	_Unindex(editor);
+	_Index(editor);
+}
+
+
+/* static */
+entry_ref
+EditorTabManager::_ResolvedRef(const entry_ref* ref)
+{
+	// symbolic links are resolved, as editors are the same if they
+	// point to the same file
+	entry_ref resolved;
+	BEntry entry(ref, true);
+	if (entry.GetRef(&resolved) != B_OK)
+		return entry_ref();
+	return resolved;
+}
+
+
+void
+EditorTabManager::_Index(Editor* editor)
+{
+	Keys& keys = fEditorKeys[editor];
+	keys.nodeRef = *editor->NodeRef();
+	keys.entryRef = _ResolvedRef(editor->FileRef());
+
+	if (keys.nodeRef.device >= 0)
+		fEditorsByNode[keys.nodeRef] = editor;
+	if (keys.entryRef.name != nullptr)
+		fEditorsByRef[keys.entryRef] = editor;
+}
+
+
+void
+EditorTabManager::_Unindex(Editor* editor)
+{
+	auto found = fEditorKeys.find(editor);
+	if (found == fEditorKeys.end())
+		return;
+
+	const Keys& keys = found->second;
+	auto byNode = fEditorsByNode.find(keys.nodeRef);
+	if (byNode != fEditorsByNode.end() && byNode->second == editor)
+		fEditorsByNode.erase(byNode);
+	auto byRef = fEditorsByRef.find(keys.entryRef);
+	if (byRef != fEditorsByRef.end() && byRef->second == editor)
+		fEditorsByRef.erase(byRef);
+	fEditorKeys.erase(found);
 }
 
 
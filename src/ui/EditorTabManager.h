@@ -5,9 +5,14 @@
 #pragma once
 
 #include "TabManager.h"
+#include <Entry.h>
+#include <Node.h>
 #include <PopUpMenu.h>
 #include <MenuItem.h>
 
+#include <string>
+#include <unordered_map>
+
 class Editor;
 class EditorTabManager : public TabManager {
 public:
@@ -19,10 +24,47 @@ public:
 	Editor*		EditorBy(const entry_ref* ref) const;
 	Editor*		EditorBy(const node_ref* nodeRef) const;
 
+	void		AddTab(Editor* editor, const char* label, int32 index = -1,
+					BMessage* addInfo = nullptr);
+	BView*		RemoveTab(int32 index);
+
+	// Called by the Editor when its file or node changes
+	void		EditorChanged(Editor* editor);
+
 	BString		GetToolTipText(int32 index) override;
 
 	void		ShowTabMenu(BMessenger target, BPoint where,int32 index) override;
 
 private:
+	struct NodeRefHash {
+		size_t operator()(const node_ref& ref) const
+		{
+			return std::hash<ino_t>()(ref.node) ^ (std::hash<dev_t>()(ref.device) << 1);
+		}
+	};
+
+	struct EntryRefHash {
+		size_t operator()(const entry_ref& ref) const
+		{
+			return std::hash<ino_t>()(ref.directory) ^ (std::hash<dev_t>()(ref.device) << 1)
+				^ (std::hash<std::string>()(ref.name != nullptr ? ref.name : "") << 2);
+		}
+	};
+
+	struct Keys {
+		node_ref	nodeRef;
+		entry_ref	entryRef;
+	};
+
+	static	entry_ref	_ResolvedRef(const entry_ref* ref);
+			void		_Index(Editor* editor);
+			void		_Unindex(Editor* editor);
+
 	BPopUpMenu* fPopUpMenu;
+
+	// Lookup tables of the open editors
+	std::unordered_map<node_ref, Editor*, NodeRefHash>	fEditorsByNode;
+	// by the entry of the file, which is kept when a parent folder is renamed
+	std::unordered_map<entry_ref, Editor*, EntryRefHash>	fEditorsByRef;
+	std::unordered_map<Editor*, Keys>					fEditorKeys;
 };
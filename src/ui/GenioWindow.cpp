@@ -6,8 +6,10 @@
 
 #include "GenioWindow.h"
 
+#include <algorithm>
 #include <cassert>
 #include <string>
+#include <vector>
 
 #include <Alert.h>
 #include <Bitmap.h>
@@ -37,6 +39,7 @@
 #include "ConfigManager.h"
 #include "ConfigWindow.h"
 #include "ConsoleIOView.h"
+#include "EditorConfigCache.h"
 #include "EditorKeyDownMessageFilter.h"
 #include "EditorMouseWheelMessageFilter.h"
 #include "EditorMessages.h"
@@ -49,6 +52,7 @@
 #include "GenioWindowMessages.h"
 #include "GitAlert.h"
 #include "GitRepository.h"
+#include "GitStatus.h"
 #include "GlobalStatusView.h"
 #include "GoToLineWindow.h"
 #include "GSettings.h"
@@ -88,6 +92,9 @@ static constexpr auto kFindReplaceMinBytes = 32;
 static constexpr float kFindReplaceOPSize = 120.0f;
 static constexpr auto kFindReplaceMenuItems = 10;
 
+// node monitor events received in this time are applied together
+static constexpr bigtime_t kNodeMonitorDelay = 100000;
+
 static float kProjectsWeight  = 1.0f;
 static float kEditorWeight  = 3.14f;
 static float kOutputWeight  = 0.4f;
@@ -178,6 +185,7 @@ GenioWindow::GenioWindow(BRect frame)
 	, fSearchResultTab(nullptr)
 	, fScreenMode(kDefault)
 	, fDisableProjectNotifications(false)
+	, fPendingNodeEvents(0)
 {
 	gMainWindow = this;
 
@@ -362,6 +370,10 @@ GenioWindow::MessageReceived(BMessage* message)
 			}
 			break;
 		}
+		case kCodeActionsReceived:
+			fProblemsPanel->ShowPendingFixes(
+				static_cast<Editor*>(message->GetPointer("editor", nullptr)));
+			break;
 		case EDITOR_UPDATE_DIAGNOSTICS:
 		{
 			entry_ref ref;
@@ -417,6 +429,12 @@ GenioWindow::MessageReceived(BMessage* message)
 		case kCheckEntryRemoved:
 			_CheckEntryRemoved(message);
 			break;
+		case kFlushNodeMonitor:
+			_FlushNodeMonitorMsgs();
+			break;
+		case MSG_GIT_STATUS_CHANGED:
+			SendNotices(MSG_NOTIFY_GIT_STATUS_CHANGED, message);
+			break;
 		case B_REDO:
 		{
 			Editor* editor = fTabManager->SelectedEditor();
@@ -468,22 +486,6 @@ GenioWindow::MessageReceived(BMessage* message)
 			_UpdateProjectActivation(fActiveProject != nullptr);
 			break;
 		}
-		case EDITOR_FIND_SET_MARK:
-		{
-			entry_ref ref;
-			if (message->FindRef("ref", &ref) == B_OK) {
-				Editor* editor = fTabManager->EditorBy(&ref);
-				if (editor == fTabManager->SelectedEditor()) {
-					int32 line;
-					if (message->FindInt32("line", &line) == B_OK) {
-						BString text;
-						text << editor->Name() << " :" << line;
-						LogInfo(text.String());
-					}
-				}
-			}
-			break;
-		}
 		case EDITOR_FIND_NEXT_MISS:
 		{
 			LogInfo("Find next not found");
@@ -1104,6 +1106,7 @@ GenioWindow::MessageReceived(BMessage* message)
 		}
 		case MSG_RELOAD_EDITORCONFIG:
 		{
+			EditorConfigCache::Clear();
 			for (int32 index = 0; index < fTabManager->CountTabs(); index++) {
 				Editor* editor = fTabManager->EditorAt(index);
 				editor->LoadEditorConfig();
@@ -1131,6 +1134,10 @@ GenioWindow::MessageReceived(BMessage* message)
 				}
 
 				editor->GrabFocus();
+				// the tabs reopened at startup are all selected in turn:
+				// only the one still selected is opened on the LSP server
+				if (editor == fTabManager->SelectedEditor())
+					editor->GetLSPEditorWrapper()->Activate();
 				_UpdateTabChange(editor, "TABMANAGER_TAB_SELECTED");
 
 				BMessage tabSelectedNotice(MSG_NOTIFY_EDITOR_FILE_SELECTED);
@@ -1870,6 +1877,8 @@ GenioWindow::_FileOpenWithPosition(entry_ref* ref, bool openWithPreferred, int32
 		return B_ERROR;
 	}
 
+	const bigtime_t start = system_time();
+
 	//this will force getting the caret position from file attributes when loaded.
 	GMessage selectTabInfo = {{ "caret_position", true }, {"start:line", be_line},{"start:character", lsp_char}};
 
@@ -1899,7 +1908,8 @@ GenioWindow::_FileOpenWithPosition(entry_ref* ref, bool openWithPreferred, int32
 	// TODO: Move some other stuff into _PostFileLoad()
 	_PostFileLoad(editor);
 
-	LogInfo("File open: %s [%d]", editor->Name().String(), index);
+	LogInfo("File open: %s [%d] in %" B_PRId64 " ms", editor->Name().String(), index,
+		(system_time() - start) / 1000);
 	return B_OK;
 }
 
@@ -2001,6 +2011,10 @@ GenioWindow::_FileSave(int32 index)
 void
 GenioWindow::_FileSaveAll(ProjectFolder* onlyThisProject)
 {
+	const bigtime_t start = system_time();
+
+	// The files are written at the same time, each one by its own thread
+	std::vector<Editor*> saving;
 	const int32 filesCount = fTabManager->CountTabs();
 	for (int32 index = 0; index < filesCount; index++) {
 		Editor* editor = fTabManager->EditorAt(index);
@@ -2016,8 +2030,38 @@ GenioWindow::_FileSaveAll(ProjectFolder* onlyThisProject)
 		if (onlyThisProject != NULL && editor->GetProjectFolder() != onlyThisProject)
 			continue;
 
-		if (editor->IsModified())
-			_FileSave(index);
+		if (!editor->IsModified())
+			continue;
+
+		// Readonly file, should not happen
+		if (editor->IsReadOnly()) {
+			LogErrorF("File is read-only (%s)", editor->FilePath().String());
+			continue;
+		}
+
+		_PreFileSave(editor);
+		editor->StopMonitoring();
+		if (editor->StartSave() == B_OK)
+			saving.push_back(editor);
+		else
+			editor->StartMonitoring();
+	}
+
+	for (Editor* editor : saving) {
+		status_t saveStatus = editor->FinishSave();
+		editor->StartMonitoring();
+
+		if (saveStatus == B_OK)
+			LogInfoF("File saved! (%s)", editor->FilePath().String());
+		else
+			LogErrorF("Error saving file! (%s): %s", editor->FilePath().String(), ::strerror(saveStatus));
+
+		_PostFileSave(editor);
+	}
+
+	if (!saving.empty()) {
+		LogInfo("Saved %d files in %" B_PRId64 " ms", (int32)saving.size(),
+			(system_time() - start) / 1000);
 	}
 }
 
@@ -2415,13 +2459,18 @@ GenioWindow::_CheckEntryRemoved(BMessage *msg)
 	BString name;
 	int64 dir;
 
-	if (msg->FindInt32("device", &nref.device) != B_OK
-		|| msg->FindString("name", &name) != B_OK
-		|| msg->FindInt64("directory", &dir) != B_OK
-		|| msg->FindInt64("node", &nref.node) != B_OK)
-			return;
+	for (int32 i = 0; msg->FindInt32("device", i, &nref.device) == B_OK
+		&& msg->FindString("name", i, &name) == B_OK
+		&& msg->FindInt64("directory", i, &dir) == B_OK
+		&& msg->FindInt64("node", i, &nref.node) == B_OK; i++) {
+		_CheckEntryRemoved(nref, dir, name.String());
+	}
+}
 
 
+void
+GenioWindow::_CheckEntryRemoved(node_ref nref, int64 dir, const char* name)
+{
 	// Let's check if the path exists, if the file is loaded in Genio
 	// and if the current genio node_ref is the same as the one of the path received.
 
@@ -2434,7 +2483,7 @@ GenioWindow::_CheckEntryRemoved(BMessage *msg)
 		if (fileDir.GetEntry(&entry) == B_OK) {
 			BPath path;
 			entry.GetPath(&path);
-			if (path.Append(name.String()) == B_OK) {
+			if (path.Append(name) == B_OK) {
 				entry.SetTo(path.Path());
 				if (entry.Exists()) {
 					Editor* editor = fTabManager->EditorBy(&nref);
@@ -2479,26 +2528,39 @@ GenioWindow::_HandleNodeMonitorMsg(BMessage* msg)
 		return;
 	}
 
+	// a tool rewriting a file generates a burst of events: they are
+	// collected and applied together when it's over
+	const int32 order = fPendingNodeEvents++;
+	if (order == 0) {
+		BMessage flush(kFlushNodeMonitor);
+		BMessageRunner::StartSending(this, &flush, kNodeMonitorDelay, 1);
+	}
+
 	switch (opcode) {
 		case B_ENTRY_MOVED: {
-			int32 device;
+			node_ref nref;
 			int64 srcDir;
 			int64 dstDir;
 			BString name;
 			BString oldName;
 
-			if (msg->FindInt32("device", &device) != B_OK
+			if (msg->FindInt32("device", &nref.device) != B_OK
+				|| msg->FindInt64("node", &nref.node) != B_OK
 				|| msg->FindInt64("to directory", &dstDir) != B_OK
 				|| msg->FindInt64("from directory", &srcDir) != B_OK
 				|| msg->FindString("name", &name) != B_OK
 				|| msg->FindString("from name", &oldName) != B_OK)
 					break;
 
-			entry_ref oldRef(device, srcDir, oldName.String());
-			entry_ref newRef(device, dstDir, name.String());
-
-			_HandleExternalMoveModification(&oldRef, &newRef);
+			entry_ref oldRef(nref.device, srcDir, oldName.String());
+			entry_ref newRef(nref.device, dstDir, name.String());
 
+			// moved more than once: from the first to the last location
+			auto found = fPendingNodeMsgs.find(std::make_pair(nref, opcode));
+			if (found != fPendingNodeMsgs.end())
+				found->second.to = newRef;
+			else
+				fPendingNodeMsgs[std::make_pair(nref, opcode)] = { order, oldRef, newRef };
 			break;
 		}
 		case B_ENTRY_REMOVED: {
@@ -2516,11 +2578,16 @@ GenioWindow::_HandleNodeMonitorMsg(BMessage* msg)
 
 			// Let's deferr the decision to some milliseconds to have a better understanding
 			// of what's going on.
+			node_ref nref;
+			if (msg->FindInt32("device", &nref.device) != B_OK
+				|| msg->FindInt64("node", &nref.node) != B_OK)
+					break;
 
-			msg->what = kCheckEntryRemoved;
-			BMessageRunner::StartSending(this, msg, 1500, 1);
+			PendingNodeEvent& removal = fPendingNodeMsgs.emplace(std::make_pair(nref, opcode),
+				PendingNodeEvent{ order }).first->second;
+			removal.message = *msg;
+			break;
 		}
-		break;
 		case B_STAT_CHANGED: {
 			node_ref nref;
 			int32 fields;
@@ -2536,8 +2603,8 @@ GenioWindow::_HandleNodeMonitorMsg(BMessage* msg)
 			if (((fields & B_STAT_MODIFICATION_TIME)  != 0)
 			// Do not reload if the file just got touched
 				&& ((fields & B_STAT_ACCESS_TIME)  == 0)) {
-//				BNode node(&nref);
-				_HandleExternalStatModification(_GetEditorIndex(&nref));
+				fPendingNodeMsgs.emplace(std::make_pair(nref, opcode),
+					PendingNodeEvent{ order });
 			}
 
 			break;
@@ -2547,6 +2614,69 @@ GenioWindow::_HandleNodeMonitorMsg(BMessage* msg)
 	}
 }
 
+
+void
+GenioWindow::_FlushNodeMonitorMsgs()
+{
+	// the alerts shown below don't let new events in until they are closed
+	std::map<std::pair<node_ref, int32>, PendingNodeEvent> pending;
+	pending.swap(fPendingNodeMsgs);
+
+	LogDebug("Node monitor: %d events, %d applied", fPendingNodeEvents,
+		(int32)pending.size());
+	fPendingNodeEvents = 0;
+
+	// applied in the order they arrived
+	typedef std::map<std::pair<node_ref, int32>, PendingNodeEvent>::value_type Event;
+	std::vector<const Event*> events;
+	events.reserve(pending.size());
+	for (const Event& event : pending)
+		events.push_back(&event);
+	std::sort(events.begin(), events.end(), [](const Event* a, const Event* b) {
+		return a->second.order < b->second.order;
+	});
+
+	// the removed nodes are checked all together a bit later
+	BMessage removals(kCheckEntryRemoved);
+	for (const Event* event : events) {
+		node_ref nref = event->first.first;
+		const PendingNodeEvent& info = event->second;
+		switch (event->first.second) {
+			case B_ENTRY_MOVED:
+			{
+				// moved back to where it was
+				if (info.from == info.to)
+					break;
+				entry_ref from(info.from);
+				entry_ref to(info.to);
+				_HandleExternalMoveModification(&from, &to);
+				break;
+			}
+			case B_ENTRY_REMOVED:
+			{
+				BString name;
+				int64 dir;
+				if (info.message.FindString("name", &name) != B_OK
+					|| info.message.FindInt64("directory", &dir) != B_OK) {
+					break;
+				}
+				removals.AddInt32("device", nref.device);
+				removals.AddInt64("node", nref.node);
+				removals.AddInt64("directory", dir);
+				removals.AddString("name", name);
+				break;
+			}
+			case B_STAT_CHANGED:
+				_HandleExternalStatModification(_GetEditorIndex(&nref));
+				break;
+		}
+	}
+
+	if (removals.HasInt64("node"))
+		BMessageRunner::StartSending(this, &removals, 1500, 1);
+}
+
+
 void
 GenioWindow::_InitCommandRunToolbar()
 {
@@ -3839,6 +3969,7 @@ GenioWindow::_ProjectFolderOpen(BMessage *message)
 status_t
 GenioWindow::_ProjectFolderOpen(const entry_ref& ref, bool activate)
 {
+	bigtime_t start = system_time();
 	BEntry dirEntry(&ref, true);
 	if (!dirEntry.Exists())
 		return B_NAME_NOT_FOUND;
@@ -3934,6 +4065,8 @@ GenioWindow::_ProjectFolderOpen(const entry_ref& ref, bool activate)
 	BString notification;
 	notification << opened << newProject->Name() << " at " << projectPath;
 	LogInfo(notification.String());
+	LogInfo("Project %s opened in %" B_PRId64 " ms", newProject->Name().String(),
+		(system_time() - start) / 1000);
 
 	for (int32 i = 0; i < fTabManager->CountTabs(); i++) {
 		Editor* editor = fTabManager->EditorAt(i);
@@ -4509,6 +4642,11 @@ GenioWindow::_HandleConfigurationChanged(BMessage* message)
 		fFindWrapCheck->SetValue(gCFG["find_wrap"] ? B_CONTROL_ON : B_CONTROL_OFF);
 		fFindWholeWordCheck->SetValue(gCFG["find_whole_word"] ? B_CONTROL_ON : B_CONTROL_OFF);
 		fFindCaseSensitiveCheck->SetValue(gCFG["find_match_case"] ? B_CONTROL_ON : B_CONTROL_OFF);
+		// the indexes skip the excluded folders
+		if (key == "find_exclude_directory") {
+			for (int32 index = 0; index < fProjectsFolderBrowser->CountProjects(); index++)
+				fProjectsFolderBrowser->ProjectAt(index)->UpdateIndex();
+		}
 	} else if (key.Compare("wrap_lines") == 0) {
 		ActionManager::SetPressed(MSG_WRAP_LINES, gCFG["wrap_lines"]);
 	} else if (key.Compare("show_white_space") == 0) {
@@ -4551,8 +4689,8 @@ void
 GenioWindow::_HandleProjectConfigurationChanged(BMessage* message)
 {
 	// TODO: This could go into ProjectBrowser in part or entirely
-	const ProjectFolder* project
-		= reinterpret_cast<const ProjectFolder*>(message->GetPointer("project_folder", nullptr));
+	ProjectFolder* project
+		= reinterpret_cast<ProjectFolder*>(message->GetPointer("project_folder", nullptr));
 	if (project == nullptr) {
 		LogError("GenioWindow: Update project configuration message without a project folder pointer!");
 		return;
@@ -4575,6 +4713,14 @@ GenioWindow::_HandleProjectConfigurationChanged(BMessage* message)
 				fTabManager->SetTabColor(editor, project->Color());
 			}
 		}
+	} else if (key == "project_search_index") {
+		// the project could have been closed in the meantime
+		for (int32 index = 0; index < fProjectsFolderBrowser->CountProjects(); index++) {
+			if (fProjectsFolderBrowser->ProjectAt(index) == project) {
+				project->UpdateIndex();
+				break;
+			}
+		}
 	}
 }
 
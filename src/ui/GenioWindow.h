@@ -4,10 +4,16 @@
  */
 #pragma once
 
+#include <Entry.h>
+#include <Message.h>
+#include <Node.h>
 #include <ObjectList.h>
 #include <String.h>
 #include <Window.h>
 
+#include <map>
+#include <set>
+#include <utility>
 #include <vector>
 
 #include "GMessage.h"
@@ -111,7 +117,10 @@ private:
 			void				_HandleExternalStatModification(int32 index);
 			void				_HandleExternalStatModification(Editor* editor);
 			void				_HandleNodeMonitorMsg(BMessage* msg);
+			void				_FlushNodeMonitorMsgs();
 			void				_CheckEntryRemoved(BMessage* msg);
+			void				_CheckEntryRemoved(node_ref nref, int64 dir,
+									const char* name);
 			void				_InitCentralSplit();
 			void				_InitCommandRunToolbar();
 			void				_InitMenu();
@@ -261,6 +270,17 @@ private:
 			GMessage			fScreenModeSettings;
 
 			bool				fDisableProjectNotifications;
+
+			// node monitor events of the open files, applied in batches:
+			// one for each node and opcode, in the order they first arrived
+			struct PendingNodeEvent {
+				int32		order;
+				entry_ref	from;
+				entry_ref	to;
+				BMessage	message;
+			};
+			std::map<std::pair<node_ref, int32>, PendingNodeEvent>	fPendingNodeMsgs;
+			int32				fPendingNodeEvents;
 #ifdef GDEBUG
 			BString				fTitlePrefix;
 #endif
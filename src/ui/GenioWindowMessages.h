@@ -158,8 +158,11 @@ enum {
 													// project_name (string)
 													// status (int32)
 	MSG_NOTIFY_PROJECT_LIST_CHANGED		= 'nplc',
-	MSG_NOTIFY_PROJECT_SET_ACTIVE		= 'npsa'	// active_project (pointer)
+	MSG_NOTIFY_PROJECT_SET_ACTIVE		= 'npsa',	// active_project (pointer)
 													// active_project_name (string)
+	MSG_NOTIFY_GIT_STATUS_CHANGED		= 'ngsc'	// project (string)
+													// path, status (string, int32)
+													// removed (string)
 };
 
 #endif // GenioWindowMessages_H
@@ -12,6 +12,11 @@
 
 #include "Log.h"
 
+// Entries without a MIME type are usually waiting for the registrar
+// to set it: they are checked again a few times before giving up
+static const int32 kMaxTypeChecks = 5;
+static const bigtime_t kTypeCheckInterval = 1000000;
+
 
 IconCache IconCache::sInstance;
 
@@ -21,58 +26,50 @@ IconCache::IconCache()
 
 
 const BBitmap*
-IconCache::GetIcon(const entry_ref *ref)
+IconCache::GetIcon(const entry_ref *ref, icon_size which)
 {
-	// TODO: Rework GetIcon() to include icon size as a parameter
-	BNode node(ref);
-	const BNodeInfo nodeInfo(&node);
-	char mimeType[B_MIME_TYPE_LENGTH];
-	const char* mimeTypePtr = mimeType;
-	if (nodeInfo.GetType(mimeType) != B_OK) {
-		LogDebug("Invalid mimeType for file [%s]", ref->name);
-		if (node.IsDirectory())
-			mimeTypePtr = B_DIRECTORY_MIME_TYPE;
-		else
-			mimeTypePtr = B_FILE_MIME_TYPE;
-	}
+	const std::string& mimeType = sInstance._MimeType(ref);
 
-	LogTrace("IconCache: [%s] - [%s]", mimeTypePtr, ref->name);
+	BString key;
+	key.SetToFormat("%s:%" B_PRId32, mimeType.c_str(), (int32)which);
 
-	auto it = sInstance.fCache.find(mimeTypePtr);
-	if (it != sInstance.fCache.end()) {
-		LogTrace("IconCache: return icon from cache for %s", mimeTypePtr);
+	auto it = sInstance.fCache.find(key.String());
+	if (it != sInstance.fCache.end())
 		return it->second;
-	} else {
-		LogTrace("IconCache: could not find an icon in cache for %s", mimeTypePtr);
-		// TODO: we calculate icon size here, but we should pass it as a parameter
-		// to GetIcon(), because it's done in StyledItem::DrawIcon, too
-		const BSize composedSize = be_control_look->ComposeIconSize(B_MINI_ICON);
-		const icon_size iconSize = icon_size(composedSize.IntegerHeight());
-		const BRect rect(0, 0, iconSize - 1, iconSize - 1);
-		BBitmap *icon = new BBitmap(rect, B_RGBA32);
-		status_t status = nodeInfo.GetTrackerIcon(icon, iconSize);
-		if (status != B_OK) {
-			LogError("IconCache: GetTrackerIcon returned - %s", ::strerror(status));
-			// Fall back to the generic icon
-			// TODO: this happens with the locale "Translation Catalog" type which has
-			// no icon. Should GetTrackerIcon() return the generic icon itself ?
-			BMimeType type(B_FILE_MIME_TYPE);
-			type.GetIcon(icon, iconSize);
-		}
-		sInstance.fCache.emplace(mimeTypePtr, icon);
-		return icon;
+
+	LogTrace("IconCache: could not find an icon in cache for %s", key.String());
+	const BSize composedSize = be_control_look->ComposeIconSize(which);
+	const icon_size iconSize = icon_size(composedSize.IntegerHeight());
+	const BRect rect(0, 0, iconSize - 1, iconSize - 1);
+	BBitmap *icon = new BBitmap(rect, B_RGBA32);
+	status_t status = BNodeInfo::GetTrackerIcon(ref, icon, iconSize);
+	if (status != B_OK) {
+		LogError("IconCache: GetTrackerIcon returned - %s", ::strerror(status));
+		// Fall back to the generic icon
+		// TODO: this happens with the locale "Translation Catalog" type which has
+		// no icon. Should GetTrackerIcon() return the generic icon itself ?
+		BMimeType type(B_FILE_MIME_TYPE);
+		type.GetIcon(icon, iconSize);
 	}
-	return nullptr;
+	sInstance.fCache.emplace(key.String(), icon);
+	return icon;
 }
 
 
 const BBitmap*
-IconCache::GetIcon(const BString& path)
+IconCache::GetIcon(const BString& path, icon_size which)
 {
 	const BEntry entry(path);
 	entry_ref ref;
 	entry.GetRef(&ref);
-	return IconCache::GetIcon(&ref);
+	return IconCache::GetIcon(&ref, which);
+}
+
+
+void
+IconCache::Invalidate(const entry_ref *ref)
+{
+	sInstance.fTypes.erase(*ref);
 }
 
 
@@ -83,5 +80,42 @@ IconCache::PrintToStream()
 	for (auto const& x : sInstance.fCache) {
 		printf("IconCache: %s\n", x.first.c_str());
 	}
+	printf("IconCache: %d entry types\n", (int32)sInstance.fTypes.size());
 	printf("----------------------------\n");
 }
+
+
+const std::string&
+IconCache::_MimeType(const entry_ref* ref)
+{
+	auto found = fTypes.find(*ref);
+	if (found != fTypes.end()) {
+		EntryType& type = found->second;
+		if (type.typed || type.checks >= kMaxTypeChecks
+			|| system_time() - type.lastCheck < kTypeCheckInterval) {
+			return type.mimeType;
+		}
+	}
+
+	BNode node(ref);
+	const BNodeInfo nodeInfo(&node);
+	char mimeType[B_MIME_TYPE_LENGTH];
+	const char* mimeTypePtr = mimeType;
+	const bool typed = nodeInfo.GetType(mimeType) == B_OK;
+	if (!typed) {
+		LogDebug("Invalid mimeType for file [%s]", ref->name);
+		if (node.IsDirectory())
+			mimeTypePtr = B_DIRECTORY_MIME_TYPE;
+		else
+			mimeTypePtr = B_FILE_MIME_TYPE;
+	}
+
+	LogTrace("IconCache: [%s] - [%s]", mimeTypePtr, ref->name);
+
+	EntryType& type = fTypes[*ref];
+	type.mimeType = mimeTypePtr;
+	type.typed = typed;
+	type.checks++;
+	type.lastCheck = system_time();
+	return type.mimeType;
+}
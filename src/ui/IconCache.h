@@ -7,23 +7,46 @@
 #include <string>
 #include <unordered_map>
 
+#include <Entry.h>
+#include <Mime.h>
 #include <String.h>
 
-struct entry_ref;
-
 class BBitmap;
+
+// Icons are cached by MIME type and size. The MIME type of each entry is
+// cached too, so drawing a known entry does no file system I/O: the cached
+// type must be invalidated when the entry changes.
 class IconCache {
 public:
 	IconCache(IconCache const&) = delete;
 	void operator=(IconCache const&) = delete;
 
-	static const BBitmap* GetIcon(const entry_ref *ref);
-	static const BBitmap* GetIcon(const BString& path);
+	static const BBitmap* GetIcon(const entry_ref *ref, icon_size which = B_MINI_ICON);
+	static const BBitmap* GetIcon(const BString& path, icon_size which = B_MINI_ICON);
+	static void		Invalidate(const entry_ref *ref);
 	static void 	PrintToStream();
 
 private:
+	struct EntryRefHash {
+		size_t operator()(const entry_ref& ref) const
+		{
+			return std::hash<ino_t>()(ref.directory) ^ (std::hash<dev_t>()(ref.device) << 1)
+				^ (ref.name != nullptr ? std::hash<std::string>()(ref.name) << 2 : 0);
+		}
+	};
+
+	struct EntryType {
+		std::string		mimeType;
+		bool			typed = false;
+		int32			checks = 0;
+		bigtime_t		lastCheck = 0;
+	};
+
 	IconCache();
 
+	const std::string&	_MimeType(const entry_ref* ref);
+
+	std::unordered_map<entry_ref, EntryType, EntryRefHash> fTypes;
 	std::unordered_map<std::string, BBitmap*> fCache;
 
 	static IconCache sInstance;
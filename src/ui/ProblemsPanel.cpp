@@ -7,6 +7,7 @@
 
 #include "ProblemsPanel.h"
 
+#include "EditorContextMenu.h"
 #include "EditorMessages.h"
 #include "GMessage.h"
 #include "LSPEditorWrapper.h"
@@ -14,11 +15,16 @@
 #include <Catalog.h>
 #include <ColumnTypes.h>
 #include <MenuItem.h>
+#include <MessageRunner.h>
 #include <PopUpMenu.h>
 #include <TabView.h>
 #include <Window.h>
 
+#include <deque>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "ProblemsPanel"
@@ -41,14 +47,29 @@ class RangeRow : public BRow {
 
 		GMessage	fRange;
 		Editor 		*fEditor;
+		std::string	fKey;
 
 };
 
 #define ProblemLabel B_TRANSLATE("Problems")
 
+
+static Range
+ToRange(GMessage& range)
+{
+	Range lspRange;
+	lspRange.start.line = range["start:line"];
+	lspRange.start.character = range["start:character"];
+	lspRange.end.line = range["end:line"];
+	lspRange.end.character = range["end:character"];
+	return lspRange;
+}
+
+
 ProblemsPanel::ProblemsPanel(BTabView* tabView): BColumnListView(ProblemLabel,
 									B_NAVIGABLE, B_FANCY_BORDER, true)
 									, fTabView(tabView)
+									, fPendingEditor(nullptr)
 
 {
 	AddColumn(new BStringColumn( B_TRANSLATE("Category"),
@@ -99,44 +120,38 @@ ProblemsPanel::MessageReceived(BMessage* msg)
 			uint32 buttons = 0;
 			GetMouse(&where, &buttons);
 			where.x += 2; // to prevent occasional select
-			if (buttons & B_SECONDARY_MOUSE_BUTTON) {
-				RangeRow* row = dynamic_cast<RangeRow*>(CurrentSelection());
-				if (!row)
-					return;
-
-				LSPEditorWrapper* lsp = row->fEditor->GetLSPEditorWrapper();
-				if (lsp) {
-					LSPDiagnostic dia;
-
-					Range range;
-					range.start.line = row->fRange["start:line"];
-					range.start.character = row->fRange["start:character"];
-					range.end.line = row->fRange["end:line"];
-					range.end.character = row->fRange["end:character"];
-
-					int32 index = lsp->DiagnosticFromRange(range, dia);
-					fPopUpMenu = new BPopUpMenu("_popup");
-					fPopUpMenu->SetRadioMode(false);
-					if (index > -1 && dia.diagnostic.codeActions.value().size() > 0) {
-						std::vector<CodeAction> actions = dia.diagnostic.codeActions.value();
-						for (int i = 0; i < static_cast<int>(actions.size()); i++) {
-							auto item = new BMenuItem(actions[i].title.c_str(),
-								new GMessage({{"what", kApplyFix}, {"index", index}, {"action", i},
-								{"quickFix", true}}));
-							fPopUpMenu->AddItem(item);
-						}
-					} else {
-						auto item = new BMenuItem(B_TRANSLATE("No fix available"), nullptr);
-						item->SetEnabled(false);
-						fPopUpMenu->AddItem(item);
-					}
-					fPopUpMenu->SetTargetForItems((BHandler*)row->fEditor);
-					fPopUpMenu->Go(ConvertToScreen(where), true);
-					delete fPopUpMenu;
+			RangeRow* row = dynamic_cast<RangeRow*>(CurrentSelection());
+			if (!row)
+				return;
+
+			LSPEditorWrapper* lsp = row->fEditor->GetLSPEditorWrapper();
+			if (lsp) {
+				LSPDiagnostic dia;
+				Range range = ToRange(row->fRange);
+				int32 index = lsp->DiagnosticFromRange(range, dia);
+				// the fixes are asked to the server only for the problems selected:
+				// the menu is shown when they arrive, see ShowPendingFixes()
+				fPendingEditor = nullptr;
+				const bool requested = lsp->RequestCodeActions(index);
+				if (buttons & B_SECONDARY_MOUSE_BUTTON) {
+					if (requested) {
+						fPendingEditor = row->fEditor;
+						fPendingRange = row->fRange;
+						fPendingPoint = ConvertToScreen(where);
+						BMessage timeout(kShowContextMenu);
+						BMessageRunner::StartSending(BMessenger(this), &timeout,
+							EditorContextMenu::kFixesTimeout, 1);
+					} else
+						_ShowFixes(row->fEditor, row->fRange, ConvertToScreen(where));
 				}
 			}
 			break;
 		}
+		case kShowContextMenu:
+		{
+			ShowPendingFixes(fPendingEditor);
+			break;
+		}
 		default:
 			BColumnListView::MessageReceived(msg);
 			break;
@@ -144,42 +159,129 @@ ProblemsPanel::MessageReceived(BMessage* msg)
 }
 
 
+void
+ProblemsPanel::ShowPendingFixes(Editor* editor)
+{
+	if (editor == nullptr || editor != fPendingEditor)
+		return;
+	fPendingEditor = nullptr;
+	_ShowFixes(editor, fPendingRange, fPendingPoint);
+}
+
+
+void
+ProblemsPanel::_ShowFixes(Editor* editor, GMessage& range, BPoint where)
+{
+	LSPEditorWrapper* lsp = editor->GetLSPEditorWrapper();
+	if (lsp == nullptr)
+		return;
+
+	LSPDiagnostic dia;
+	Range lspRange = ToRange(range);
+	int32 index = lsp->DiagnosticFromRange(lspRange, dia);
+
+	fPopUpMenu = new BPopUpMenu("_popup");
+	fPopUpMenu->SetRadioMode(false);
+	if (index > -1 && dia.diagnostic.codeActions.value().size() > 0) {
+		std::vector<CodeAction> actions = dia.diagnostic.codeActions.value();
+		for (int i = 0; i < static_cast<int>(actions.size()); i++) {
+			auto item = new BMenuItem(actions[i].title.c_str(),
+				new GMessage({{"what", kApplyFix}, {"index", index}, {"action", i},
+				{"quickFix", true}}));
+			fPopUpMenu->AddItem(item);
+		}
+	} else {
+		auto item = new BMenuItem(B_TRANSLATE("No fix available"), nullptr);
+		item->SetEnabled(false);
+		fPopUpMenu->AddItem(item);
+	}
+	fPopUpMenu->SetTargetForItems((BHandler*)editor);
+	fPopUpMenu->Go(where, true);
+	delete fPopUpMenu;
+}
+
+
 void
 ProblemsPanel::UpdateProblems(Editor* editor)
 {
-	Clear();
+	// another editor is shown: its problems are no longer listed
+	if (editor != fPendingEditor)
+		fPendingEditor = nullptr;
 
 	LSPEditorWrapper* lsp = editor->GetLSPEditorWrapper();
-	if (lsp) {
-		std::vector<LSPDiagnostic> diagnostics;
-		lsp->GetDiagnostics(diagnostics);
-		for (auto& dia: diagnostics) {
-			RangeRow* row = new RangeRow();
-
-			GMessage range;
-			range["start:line"] = dia.diagnostic.range.start.line;
-			range["start:character"] = dia.diagnostic.range.start.character;
-			range["end:line"] = dia.diagnostic.range.end.line;
-			range["end:character"] = dia.diagnostic.range.end.character;
-			row->fRange = range;
-			row->fEditor = editor;
-			row->fRange.AddRef("refs", editor->FileRef());
-			row->SetField(new BStringField(dia.diagnostic.category.value().c_str()), kCategoryColumn);
-			row->SetField(new BStringField(dia.diagnostic.message.c_str()), kMessageColumn);
-			row->SetField(new BStringField(dia.diagnostic.source.c_str()), kSourceColumn);
-			BString line;
-			line.SetToFormat("%d", dia.diagnostic.range.start.line + 1);
-			row->SetField(new BStringField(line), kPositionColumn);
-			AddRow(row);
+	if (!lsp) {
+		Clear();
+		return;
+	}
+
+	std::vector<LSPDiagnostic> diagnostics;
+	lsp->GetDiagnostics(diagnostics);
+
+	// the rows of the problems still there are kept, in the same order
+	std::unordered_map<std::string, std::deque<RangeRow*>> rows;
+	for (int32 i = 0; i < CountRows(); i++) {
+		RangeRow* row = dynamic_cast<RangeRow*>(RowAt(i));
+		if (row != nullptr && row->fEditor == editor)
+			rows[row->fKey].push_back(row);
+	}
+
+	std::vector<std::string> keys;
+	std::vector<RangeRow*> kept;
+	std::set<RangeRow*> keptSet;
+	keys.reserve(diagnostics.size());
+	kept.reserve(diagnostics.size());
+	for (auto& dia: diagnostics) {
+		keys.push_back(LSPEditorWrapper::DiagnosticKey(dia.diagnostic));
+		RangeRow* row = nullptr;
+		auto found = rows.find(keys.back());
+		if (found != rows.end() && !found->second.empty()) {
+			row = found->second.front();
+			found->second.pop_front();
+			keptSet.insert(row);
 		}
-		_UpdateTabLabel();
+		kept.push_back(row);
 	}
+
+	for (int32 i = CountRows() - 1; i >= 0; i--) {
+		RangeRow* row = static_cast<RangeRow*>(RowAt(i));
+		if (keptSet.find(row) == keptSet.end()) {
+			RemoveRow(row);
+			delete row;
+		}
+	}
+
+	for (size_t i = 0; i < diagnostics.size(); i++) {
+		if (kept[i] != nullptr)
+			continue;
+
+		LSPDiagnostic& dia = diagnostics[i];
+		RangeRow* row = new RangeRow();
+
+		GMessage range;
+		range["start:line"] = dia.diagnostic.range.start.line;
+		range["start:character"] = dia.diagnostic.range.start.character;
+		range["end:line"] = dia.diagnostic.range.end.line;
+		range["end:character"] = dia.diagnostic.range.end.character;
+		row->fRange = range;
+		row->fEditor = editor;
+		row->fKey = keys[i];
+		row->fRange.AddRef("refs", editor->FileRef());
+		row->SetField(new BStringField(dia.diagnostic.category.value().c_str()), kCategoryColumn);
+		row->SetField(new BStringField(dia.diagnostic.message.c_str()), kMessageColumn);
+		row->SetField(new BStringField(dia.diagnostic.source.c_str()), kSourceColumn);
+		BString line;
+		line.SetToFormat("%d", dia.diagnostic.range.start.line + 1);
+		row->SetField(new BStringField(line), kPositionColumn);
+		AddRow(row, (int32)i);
+	}
+	_UpdateTabLabel();
 }
 
 
 void
 ProblemsPanel::ClearProblems()
 {
+	fPendingEditor = nullptr;
 	Clear();
 	_UpdateTabLabel();
 }
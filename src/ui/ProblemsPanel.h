@@ -6,6 +6,8 @@
 
 #include <ColumnListView.h>
 
+#include "GMessage.h"
+
 class BPopUpMenu;
 class BMenuItem;
 class BTabView;
@@ -22,9 +24,19 @@ public:
 
 		void ClearProblems();
 
+		// the fixes asked on a right-click arrived, or it's too late
+		// to wait for them
+		void ShowPendingFixes(Editor* editor);
+
 private:
 		void	_UpdateTabLabel();
+		void	_ShowFixes(Editor* editor, GMessage& range, BPoint where);
+
 		BTabView* fTabView;
 		BPopUpMenu* fPopUpMenu;
 		BMenuItem*  fQuickFixItem;
+
+		Editor*		fPendingEditor;
+		GMessage	fPendingRange;
+		BPoint		fPendingPoint;
 };
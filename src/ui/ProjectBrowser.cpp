@@ -8,13 +8,21 @@
 
 #include "ActionManager.h"
 #include "ConfigManager.h"
+#include "Editor.h"
+#include "EditorConfigCache.h"
+#include "EditorTabManager.h"
 #include "GenioApp.h"
+#include "GenioNamespace.h"
 #include "GenioWatchingFilter.h"
 #include "GenioWindowMessages.h"
 #include "GenioWindow.h"
+#include "GitStatus.h"
+#include "IconCache.h"
 #include "Log.h"
 #include "ProjectFolder.h"
+#include "ProjectIndex.h"
 #include "ProjectItem.h"
+#include "ProjectScanner.h"
 #include "SwitchBranchMenu.h"
 #include "TemplateManager.h"
 #include "TemplatesMenu.h"
@@ -42,27 +50,36 @@
 
 #include <cassert>
 #include <cstdio>
+#include <map>
+#include <set>
+#include <string>
 
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "ProjectsFolderBrowser"
 
 const uint32 kTick = 'tick';
+const uint32 kFlushNodeUpdates = 'flnu';
+
+// path monitor events received in this time are applied together
+static const bigtime_t kNodeUpdatesDelay = 100000;
 
 static BMessageRunner* sAnimationTickRunner;
 
 class ProjectOutlineListView : public BOutlineListView {
 public:
-					ProjectOutlineListView();
+					ProjectOutlineListView(ProjectBrowser* browser);
 	virtual 		~ProjectOutlineListView();
 
 	virtual void	MouseDown(BPoint where);
 	virtual void	MouseMoved(BPoint point, uint32 transit, const BMessage* message);
 	virtual void	AttachedToWindow();
 	virtual void	DetachedFromWindow();
+	virtual void	Draw(BRect updateRect);
 	virtual void	MessageReceived(BMessage* message);
 	virtual void	KeyDown(const char* bytes, int32 numBytes);
 	virtual void	SelectionChanged();
+	virtual void	ExpandOrCollapse(BListItem* superItem, bool expand);
 
 	ProjectItem*	ProjectItemAt(int32 index) const;
 	ProjectItem*	GetSelectedProjectItem() const;
@@ -72,6 +89,7 @@ public:
 private:
 	void			_ShowProjectItemPopupMenu(BPoint where);
 
+	ProjectBrowser*	fBrowser;
 	TemplatesMenu*	fFileNewProjectMenuItem;
 };
 
@@ -131,9 +149,13 @@ public:
 ProjectBrowser::ProjectBrowser()
 	:
 	BView("Project browser", B_WILL_DRAW|B_FRAME_EVENTS),
-	fIsBuilding(false)
+	fIsBuilding(false),
+	fScanner(nullptr),
+	fBatchingUpdates(false),
+	fRawNodeEvents(0),
+	fAppliedNodeEvents(0)
 {
-	fOutlineListView = new ProjectOutlineListView();
+	fOutlineListView = new ProjectOutlineListView(this);
 	ProjectDropView* projectDropView = new ProjectDropView();
 
 	BScrollView* scrollView = new BScrollView("scrollview", fOutlineListView,
@@ -153,6 +175,7 @@ ProjectBrowser::~ProjectBrowser()
 {
 	BPrivate::BPathMonitor::SetWatchingInterface(nullptr);
 	delete fGenioWatchingFilter;
+	delete fScanner;
 }
 
 
@@ -177,14 +200,18 @@ ProjectBrowser::_CreatePath(BPath pathToCreate)
 		BPath parent;
 		if (pathToCreate.GetParent(&parent) == B_OK) {
 			ProjectItem* parentItem = _CreatePath(parent);
+			// the content of a folder not populated yet will be read
+			// when the folder is expanded
+			if (parentItem == nullptr || !parentItem->IsPopulated())
+				return nullptr;
 			LogTrace("Creating path %s", pathToCreate.Path());
 			ProjectItem* newItem = _CreateNewProjectItem(parentItem, pathToCreate);
 
+			newItem->SetExpanded(false);
 			if (fOutlineListView->AddUnder(newItem,parentItem)) {
 				LogDebugF("AddUnder(%s,%s) (Parent %s)", newItem->Text(), parentItem->Text(), parent.Path());
-				fOutlineListView->SortItemsUnder(parentItem, true,
-					ProjectOutlineListView::CompareProjectItems);
-				fOutlineListView->Collapse(newItem);
+				_AddPlaceholder(newItem);
+				_SortItemsUnder(parentItem);
 			}
 			return newItem;
 		}
@@ -194,6 +221,56 @@ ProjectBrowser::_CreatePath(BPath pathToCreate)
 }
 
 
+void
+ProjectBrowser::_UpdateIndex(BMessage* message)
+{
+	BString watchedPath;
+	if (message->FindString("watched_path", &watchedPath) != B_OK)
+		return;
+	ProjectFolder* project = ProjectByPath(watchedPath);
+	if (project == nullptr)
+		return;
+	if (project->Index() != nullptr)
+		project->Index()->EntryChanged(message);
+	if (project->GetGitStatus() != nullptr)
+		project->GetGitStatus()->EntryChanged(message);
+}
+
+
+void
+ProjectBrowser::_InvalidateCaches(BMessage* message)
+{
+	BString changedPath;
+	if (message->FindString("path", &changedPath) == B_OK) {
+		if (fScanner != nullptr)
+			fScanner->Invalidate(changedPath);
+		EditorConfigCache::Invalidate(changedPath);
+	}
+	if (message->FindString("from path", &changedPath) == B_OK) {
+		if (fScanner != nullptr)
+			fScanner->Invalidate(changedPath);
+		EditorConfigCache::Invalidate(changedPath);
+	}
+
+	// the entries involved may have a different type now
+	entry_ref ref;
+	const char* name;
+	if (message->FindInt32("device", &ref.device) == B_OK) {
+		if (message->FindString("name", &name) == B_OK
+			&& (message->FindInt64("to directory", &ref.directory) == B_OK
+				|| message->FindInt64("directory", &ref.directory) == B_OK)) {
+			ref.set_name(name);
+			IconCache::Invalidate(&ref);
+		}
+		if (message->FindString("from name", &name) == B_OK
+			&& message->FindInt64("from directory", &ref.directory) == B_OK) {
+			ref.set_name(name);
+			IconCache::Invalidate(&ref);
+		}
+	}
+}
+
+
 void
 ProjectBrowser::_UpdateNode(BMessage* message)
 {
@@ -203,11 +280,16 @@ ProjectBrowser::_UpdateNode(BMessage* message)
 	BString watchedPath;
 	if (message->FindString("watched_path", &watchedPath) != B_OK)
 		return;
+
 	switch (opCode) {
 		case B_ENTRY_CREATED:
 		{
 			BString spath;
 			if (message->FindString("path", &spath) == B_OK) {
+				// the editor saves through a temporary file, renamed over
+				// the original one when written
+				if (spath.EndsWith(GenioNames::kSaveTempSuffix))
+					break;
 				BPath path(spath.String());
 				_CreatePath(path);
 			}
@@ -222,9 +304,16 @@ ProjectBrowser::_UpdateNode(BMessage* message)
 			LogDebug("path %s", spath.String());
 			ProjectItem *item = GetProjectItemByPath(spath);
 			if (!item) {
-				LogError("Can't find an item to remove [%s]", spath.String());
+				// not populated yet
+				LogTrace("Can't find an item to remove [%s]", spath.String());
 				return;
 			}
+			// replaced by another entry with the same name and type
+			BEntry entry(spath.String());
+			if (entry.Exists() && entry.IsDirectory()
+					== (item->GetSourceItem()->Type() != SourceItemType::FileItem)) {
+				break;
+			}
 			if (item->GetSourceItem()->Type() == SourceItemType::ProjectFolderItem) {
 				if (LockLooper()) {
 					fOutlineListView->Select(fOutlineListView->IndexOf(item));
@@ -246,8 +335,7 @@ ProjectBrowser::_UpdateNode(BMessage* message)
 				}
 			} else {
 				fOutlineListView->RemoveItem(item);
-				fOutlineListView->SortItemsUnder(fOutlineListView->Superitem(item),
-					true, ProjectOutlineListView::CompareProjectItems);
+				_SortItemsUnder(fOutlineListView->Superitem(item));
 			}
 			break;
 		}
@@ -260,7 +348,7 @@ ProjectBrowser::_UpdateNode(BMessage* message)
 					LogDebug("from path %s",  spath.String());
 					ProjectItem *item = GetProjectItemByPath(spath);
 					if (!item) {
-						LogError("Can't find an item to move [%s]", spath.String());
+						LogTrace("Can't find an item to move [%s]", spath.String());
 						return;
 					}
 					// the project folder is being renamed
@@ -292,8 +380,7 @@ ProjectBrowser::_UpdateNode(BMessage* message)
 						}
 					} else {
 						fOutlineListView->RemoveItem(item);
-						fOutlineListView->SortItemsUnder(fOutlineListView->Superitem(item),
-							true, ProjectOutlineListView::CompareProjectItems);
+						_SortItemsUnder(fOutlineListView->Superitem(item));
 					}
 				}
 			} else {
@@ -310,12 +397,13 @@ ProjectBrowser::_UpdateNode(BMessage* message)
 								BPath parent;
 								destination.GetParent(&parent);
 								ProjectItem *parentItem = _CreatePath(parent);
-								// recursive parsing!
+								if (parentItem == nullptr || !parentItem->IsPopulated())
+									break;
+								// its content is read when expanded
 								entry_ref entryRef;
 								newPathEntry.GetRef(&entryRef);
 								_ProjectFolderScan(parentItem, &entryRef, parentItem->GetSourceItem()->GetProjectFolder());
-								fOutlineListView->SortItemsUnder(parentItem, false,
-										ProjectOutlineListView::CompareProjectItems);
+								_SortItemsUnder(parentItem);
 							} else {
 								//Plain file
 								_CreatePath(destination);
@@ -339,41 +427,42 @@ ProjectBrowser::_UpdateNode(BMessage* message)
 								if (bp_oldParent == bp_newParent) {
 									ProjectItem *item = GetProjectItemByPath(oldPath);
 									if (!item) {
-										LogError("Can't find an item to move oldPath[%s] -> newPath[%s]", oldPath.String(), newPath.String());
+										LogTrace("Can't find an item to move oldPath[%s] -> newPath[%s]", oldPath.String(), newPath.String());
 										return;
 									}
 									entry_ref newRef;
 									if (get_ref_for_path(newPath, &newRef) == B_OK) {
 										item->SetText(newName);
 										item->GetSourceItem()->UpdateEntryRef(newRef);
-										fOutlineListView->SortItemsUnder(fOutlineListView->Superitem(item),
-											true, ProjectOutlineListView::CompareProjectItems);
+										_SortItemsUnder(fOutlineListView->Superitem(item));
 									} else {
 										LogError("Can't find ref for newPath[%s]", newPath.String());
 										return;
 									}
 								} else {
 									ProjectItem *item = GetProjectItemByPath(oldPath);
-									if (!item) {
-										LogError("Can't find an item to move oldPath [%s]", oldPath.String());
-										return;
-									}
 									ProjectItem *destinationItem = GetProjectItemByPath(bp_newParent.Path());
 									if (!item) {
-										LogError("Can't find an item to move newParent [%s]", bp_newParent.Path());
+										// the source folder is not populated yet
+										LogTrace("Can't find an item to move oldPath [%s]", oldPath.String());
+										if (destinationItem != nullptr && destinationItem->IsPopulated())
+											_CreatePath(bp_newPath);
 										return;
 									}
 									bool status = fOutlineListView->RemoveItem(item);
 									if (status) {
-										fOutlineListView->SortItemsUnder(
-											fOutlineListView->Superitem(item), true,
-												ProjectOutlineListView::CompareProjectItems);
-
-										ProjectItem *newItem = _CreateNewProjectItem(item, bp_newPath);
-										status = fOutlineListView->AddUnder(newItem, destinationItem);
-										if (status) {
-											fOutlineListView->SortItemsUnder(destinationItem, true,
-												ProjectOutlineListView::CompareProjectItems);
+										_SortItemsUnder(fOutlineListView->Superitem(item));
+
+										// if the destination is not populated yet, the item
+										// will be created when it's expanded
+										if (destinationItem != nullptr && destinationItem->IsPopulated()) {
+											ProjectItem *newItem = _CreateNewProjectItem(item, bp_newPath);
+											newItem->SetExpanded(false);
+											status = fOutlineListView->AddUnder(newItem, destinationItem);
+											if (status) {
+												_AddPlaceholder(newItem);
+												_SortItemsUnder(destinationItem);
+											}
 										}
 									}
 								}
@@ -390,6 +479,200 @@ ProjectBrowser::_UpdateNode(BMessage* message)
 }
 
 
+void
+ProjectBrowser::_QueueNodeUpdate(BMessage* message)
+{
+	fRawNodeEvents++;
+
+	// the caches are invalidated right away, so a folder expanded
+	// before the flush is read from disk
+	_InvalidateCaches(message);
+
+	int32 opCode;
+	if (message->FindInt32("opcode", &opCode) != B_OK
+		|| (opCode != B_ENTRY_CREATED && opCode != B_ENTRY_REMOVED
+			&& opCode != B_ENTRY_MOVED)) {
+		return;
+	}
+
+	if (fPendingUpdates.empty()) {
+		BMessage flush(kFlushNodeUpdates);
+		BMessageRunner::StartSending(BMessenger(this), &flush, kNodeUpdatesDelay, 1);
+	}
+	fPendingUpdates.push_back(*message);
+}
+
+
+void
+ProjectBrowser::_FlushNodeUpdates()
+{
+	std::vector<BMessage> updates;
+	updates.swap(fPendingUpdates);
+	if (updates.empty())
+		return;
+
+	const bigtime_t start = system_time();
+	std::vector<bool> dropped(updates.size(), false);
+
+	// the last created or removed event of each path still pending
+	std::map<std::string, size_t> last;
+	auto pending = [&](const BString& path, int32 wanted) -> ssize_t {
+		auto found = last.find(path.String());
+		if (found == last.end() || dropped[found->second])
+			return -1;
+		if (updates[found->second].GetInt32("opcode", 0) != wanted)
+			return -1;
+		return found->second;
+	};
+
+	// a folder created in this batch is listed without its content, which
+	// is read when expanded: the events pending inside it are stale once the
+	// folder is renamed or moved away, and would create it again
+	auto dropContent = [&](const BString& folder, size_t end) {
+		BString prefix(folder);
+		prefix << "/";
+		for (size_t j = 0; j < end; j++) {
+			if (dropped[j])
+				continue;
+			BString path, fromPath;
+			updates[j].FindString("path", &path);
+			updates[j].FindString("from path", &fromPath);
+			if (!path.StartsWith(prefix))
+				continue;
+			if (updates[j].GetInt32("opcode", 0) == B_ENTRY_MOVED
+				&& !fromPath.IsEmpty() && !fromPath.StartsWith(prefix)) {
+				// moved inside the folder: it's gone from where it was
+				updates[j].RemoveName("removed");
+				updates[j].AddBool("removed", true);
+			} else
+				dropped[j] = true;
+		}
+	};
+
+	// the item listed has still the type of the entry on disk
+	auto sameType = [&](const BString& path) {
+		ProjectItem* item = GetProjectItemByPath(path);
+		if (item == nullptr)
+			return false;
+		const bool folder = item->GetSourceItem()->Type() != SourceItemType::FileItem;
+		return folder == BEntry(path.String()).IsDirectory();
+	};
+
+	for (size_t i = 0; i < updates.size(); i++) {
+		BMessage& update = updates[i];
+		BString path, fromPath;
+		update.FindString("path", &path);
+		update.FindString("from path", &fromPath);
+		ssize_t previous;
+		switch (update.GetInt32("opcode", 0)) {
+			case B_ENTRY_CREATED:
+				// removed and created again: the item is still there
+				if ((previous = pending(path, B_ENTRY_REMOVED)) >= 0 && sameType(path)) {
+					dropped[previous] = dropped[i] = true;
+					last.erase(path.String());
+				} else if (pending(path, B_ENTRY_CREATED) >= 0) {
+					dropped[i] = true;
+				} else
+					last[path.String()] = i;
+				break;
+			case B_ENTRY_REMOVED:
+				// created and removed within the same batch
+				if ((previous = pending(path, B_ENTRY_CREATED)) >= 0) {
+					dropped[previous] = dropped[i] = true;
+					last.erase(path.String());
+					dropContent(path, i);
+				} else if (pending(path, B_ENTRY_REMOVED) >= 0) {
+					dropped[i] = true;
+				} else
+					last[path.String()] = i;
+				break;
+			case B_ENTRY_MOVED:
+				if (update.GetBool("removed", false)) {
+					// created and moved outside of the project
+					if ((previous = pending(fromPath, B_ENTRY_CREATED)) >= 0) {
+						dropped[previous] = dropped[i] = true;
+						last.erase(fromPath.String());
+						dropContent(fromPath, i);
+					}
+				} else if (!fromPath.IsEmpty()
+					&& (previous = pending(fromPath, B_ENTRY_CREATED)) >= 0) {
+					// created and renamed: only the final entry is created
+					dropped[previous] = true;
+					last.erase(fromPath.String());
+					dropContent(fromPath, i);
+					update.ReplaceInt32("opcode", B_ENTRY_CREATED);
+					update.RemoveName("from path");
+					last[path.String()] = i;
+				} else {
+					last.erase(fromPath.String());
+					last.erase(path.String());
+				}
+				break;
+		}
+	}
+
+	// removing a folder removes its content too
+	std::set<std::string> removedFolders;
+	for (size_t i = 0; i < updates.size(); i++) {
+		if (!dropped[i] && updates[i].GetInt32("opcode", 0) == B_ENTRY_REMOVED)
+			removedFolders.insert(updates[i].GetString("path", ""));
+	}
+	for (size_t i = 0; i < updates.size() && removedFolders.size() > 1; i++) {
+		if (dropped[i] || updates[i].GetInt32("opcode", 0) != B_ENTRY_REMOVED)
+			continue;
+		std::string path = updates[i].GetString("path", "");
+		for (size_t slash = path.rfind('/'); slash != std::string::npos && slash > 0;
+				slash = path.rfind('/', slash - 1)) {
+			if (removedFolders.find(path.substr(0, slash)) != removedFolders.end()) {
+				dropped[i] = true;
+				break;
+			}
+		}
+	}
+
+	int32 applied = 0;
+	if (Window() != nullptr)
+		Window()->DisableUpdates();
+	fBatchingUpdates = true;
+	for (size_t i = 0; i < updates.size(); i++) {
+		if (dropped[i])
+			continue;
+		_UpdateNode(&updates[i]);
+		applied++;
+	}
+	fBatchingUpdates = false;
+
+	// each folder is sorted once, if it's still in the list
+	for (BListItem* parent : fPendingSorts) {
+		if (parent == nullptr || fOutlineListView->FullListIndexOf(parent) >= 0) {
+			fOutlineListView->SortItemsUnder(parent, true,
+				ProjectOutlineListView::CompareProjectItems);
+		}
+	}
+	fPendingSorts.clear();
+	if (Window() != nullptr)
+		Window()->EnableUpdates();
+
+	fAppliedNodeEvents += applied;
+	LogDebug("ProjectBrowser: %d node events, %d applied in %" B_PRId64 " us"
+		" (%" B_PRId64 " received, %" B_PRId64 " applied so far)",
+		(int32)updates.size(), applied, system_time() - start,
+		fRawNodeEvents, fAppliedNodeEvents);
+}
+
+
+void
+ProjectBrowser::_SortItemsUnder(BListItem* parent)
+{
+	if (fBatchingUpdates) {
+		fPendingSorts.insert(parent);
+		return;
+	}
+	fOutlineListView->SortItemsUnder(parent, true,
+		ProjectOutlineListView::CompareProjectItems);
+}
+
+
 /* virtual */
 void
 ProjectBrowser::MessageReceived(BMessage* message)
@@ -399,10 +682,14 @@ ProjectBrowser::MessageReceived(BMessage* message)
 		{
 			if (Logger::IsDebugEnabled())
 				message->PrintToStream();
-			_UpdateNode(message);
+			_QueueNodeUpdate(message);
+			_UpdateIndex(message);
 			SendNotices(B_PATH_MONITOR, message);
 			break;
 		}
+		case kFlushNodeUpdates:
+			_FlushNodeUpdates();
+			break;
 		case MSG_PROJECT_MENU_OPEN_FILE:
 		{
 			int32 index = -1;
@@ -411,7 +698,7 @@ ProjectBrowser::MessageReceived(BMessage* message)
 				return;
 			}
 			ProjectItem* item = fOutlineListView->ProjectItemAt(index);
-			if (item == nullptr) {
+			if (item == nullptr || item->IsPlaceholder()) {
 				LogError("(MSG_PROJECT_MENU_OPEN_FILE) Can't find item at index %d", index);
 				return;
 			}
@@ -538,11 +825,15 @@ ProjectBrowser::MessageReceived(BMessage* message)
 			}
 			break;
 		}
+		case MSG_PROJECT_FOLDERS_SCANNED:
+			_FoldersScanned(message);
+			break;
 		case MSG_BROWSER_SELECT_ITEM:
 		{
 			ProjectItem* item = (ProjectItem*)message->GetPointer("parent_item", nullptr);
 			entry_ref ref;
 			if (item != nullptr && message->FindRef("ref", &ref) == B_OK) {
+				_PopulateItem(item);
 				int32 howMany = fOutlineListView->CountItemsUnder(item, true);
 				for (int32 i = 0; i < howMany; i++) {
 					ProjectItem* subItem = (ProjectItem*)fOutlineListView->ItemUnderAt(item, true, i);
@@ -594,8 +885,10 @@ ProjectBrowser::GetProjectItemByPath(BString const& path) const
 	const int32 countItems = fOutlineListView->FullListCountItems();
 	for (int32 i = 0; i < countItems; i++) {
 		ProjectItem *item = dynamic_cast<ProjectItem*>(fOutlineListView->FullListItemAt(i));
-		if (item != nullptr && *item->GetSourceItem()->EntryRef() == ref)
+		if (item != nullptr && !item->IsPlaceholder()
+			&& *item->GetSourceItem()->EntryRef() == ref) {
 			return item;
+		}
 	}
 
 	return nullptr;
@@ -650,12 +943,14 @@ const entry_ref*
 ProjectBrowser::GetSelectedProjectFileRef() const
 {
 	ProjectItem* selectedProjectItem = GetSelectedProjectItem();
+	if (selectedProjectItem == nullptr)
+		return nullptr;
 	return selectedProjectItem->GetSourceItem()->EntryRef();
 }
 
 
 ProjectItem*
-ProjectBrowser::GetItemByRef(ProjectFolder* project, const entry_ref& ref) const
+ProjectBrowser::GetItemByRef(ProjectFolder* project, const entry_ref& ref)
 {
 	ProjectItem* projectItem = GetProjectItemForProject(project);
 	if (projectItem == nullptr)
@@ -670,6 +965,7 @@ ProjectBrowser::GetItemByRef(ProjectFolder* project, const entry_ref& ref) const
 		BStringList list;
 		fullpath.Split("/", true, list);
 		for (int32 i = 0; i < list.CountStrings(); i++) {
+			_PopulateItem(projectItem);
 			for (int32 j = 0; j < fOutlineListView->CountItemsUnder(projectItem, true); j++) {
 				ProjectItem* pItem = (ProjectItem*)fOutlineListView->ItemUnderAt(projectItem, true, j);
 				if (pItem->GetSourceItem()->Name().Compare(list.StringAt(i)) == 0) {
@@ -719,6 +1015,9 @@ ProjectBrowser::AttachedToWindow()
 
 	ProjectTitleItem::InitAnimationIcons();
 
+	if (fScanner == nullptr)
+		fScanner = new ProjectScanner(BMessenger(this));
+
 	BMessage message(kTick);
 	if (sAnimationTickRunner == nullptr)
 		sAnimationTickRunner = new BMessageRunner(BMessenger(this), &message, bigtime_t(100000));
@@ -758,6 +1057,8 @@ ProjectBrowser::ProjectFolderDepopulate(ProjectFolder* project)
 	if (status != B_OK) {
 		LogErrorF("Can't StopWatching! path [%s] error[%s]", projectPath.String(), strerror(status));
 	}
+	if (fScanner != nullptr)
+		fScanner->RemoveProject(projectPath);
 	ProjectItem* listItem = GetProjectItemForProject(project);
 	if (listItem)
 		fOutlineListView->RemoveItem(listItem);
@@ -780,11 +1081,17 @@ ProjectBrowser::ProjectFolderPopulate(ProjectFolder* project)
 	if (fOutlineListView->CountItems() == 0)
 		static_cast<BCardLayout*>(GetLayout())->SetVisibleItem(int32(0));
 
+	const BString projectPath = project->Path();
+	// the other folders are read in background and populated when expanded
+	if (fScanner != nullptr) {
+		BString excludeDir(gCFG["find_exclude_directory"]);
+		fScanner->AddProject(projectPath, excludeDir);
+	}
+
 	ProjectItem *projectItem = _ProjectFolderScan(nullptr, project->EntryRef(), project);
-	// TODO: here we are ordering ALL the elements (maybe and option could prevent ordering the projects)
-	fOutlineListView->SortItemsUnder(nullptr, false, ProjectOutlineListView::CompareProjectItems);
+	_PopulateItem(projectItem);
+	fOutlineListView->SortItemsUnder(nullptr, true, ProjectOutlineListView::CompareProjectItems);
 
-	const BString projectPath = project->Path();
 	update_mime_info(projectPath, true, false, B_UPDATE_MIME_INFO_NO_FORCE);
 
 	assert(projectItem && project);
@@ -822,30 +1129,121 @@ ProjectBrowser::_ProjectFolderScan(ProjectItem* item, const entry_ref* ref, Proj
 		SourceItem *sourceItem = new SourceItem(*ref);
 		sourceItem->SetProjectFolder(projectFolder);
 		newItem = new ProjectItem(sourceItem);
+		newItem->SetExpanded(false);
 		fOutlineListView->AddUnder(newItem, item);
-		fOutlineListView->Collapse(newItem);
 	} else {
 		// Add project title
 		newItem = new ProjectTitleItem(projectFolder);
 		fOutlineListView->AddItem(newItem);
 	}
 
-	BEntry entry(ref);
-	if (entry.IsDirectory()) {
-		BDirectory dir(&entry);
-		entry_ref nextRef;
-		while (dir.GetNextRef(&nextRef) != B_ENTRY_NOT_FOUND) {
-			_ProjectFolderScan(newItem, &nextRef, projectFolder);
+	// the content is read when the folder is expanded
+	_AddPlaceholder(newItem);
+
+	return newItem;
+}
+
+
+void
+ProjectBrowser::_AddPlaceholder(ProjectItem* item)
+{
+	SourceItem* sourceItem = item->GetSourceItem();
+	if (sourceItem->Type() == SourceItemType::FileItem)
+		return;
+
+	// a child is needed to show the expand latch
+	SourceItem* placeholderSource = new SourceItem(*sourceItem->EntryRef(),
+		SourceItemType::FolderItem);
+	placeholderSource->SetProjectFolder(sourceItem->GetProjectFolder());
+	ProjectItem* placeholder = new ProjectItem(placeholderSource);
+	placeholder->SetText("\xe2\x80\xa6");
+	placeholder->SetPlaceholder(true);
+	placeholder->SetEnabled(false);
+	fOutlineListView->AddUnder(placeholder, item);
+	item->SetPopulated(false);
+}
+
+
+void
+ProjectBrowser::_PopulateItem(ProjectItem* item)
+{
+	if (item == nullptr || item->IsPopulated())
+		return;
+
+	item->SetPopulated(true);
+
+	// remove the placeholder
+	for (int32 i = fOutlineListView->CountItemsUnder(item, true) - 1; i >= 0; i--) {
+		BListItem* child = fOutlineListView->ItemUnderAt(item, true, i);
+		fOutlineListView->RemoveItem(child);
+		delete child;
+	}
+
+	BPath path(item->GetSourceItem()->EntryRef());
+	ProjectScanner::Folder folder;
+	if (fScanner == nullptr || !fScanner->TakeFolder(path.Path(), folder)) {
+		status_t status = ProjectScanner::ReadFolder(path.Path(), folder);
+		if (status != B_OK) {
+			LogError("Can't read folder %s: %s", path.Path(), ::strerror(status));
+			return;
 		}
 	}
 
-	return newItem;
+	// files of this folder opened in the editor
+	std::map<std::string, bool> openedFiles;
+	EditorTabManager* tabManager = gMainWindow->TabManager();
+	for (int32 i = 0; i < tabManager->CountTabs(); i++) {
+		Editor* editor = tabManager->EditorAt(i);
+		if (editor == nullptr)
+			continue;
+		const entry_ref* ref = editor->FileRef();
+		if (ref->device == folder.device && ref->directory == folder.node)
+			openedFiles[ref->name] = editor->IsModified();
+	}
+
+	ProjectFolder* projectFolder = item->GetSourceItem()->GetProjectFolder();
+	for (const ProjectScanner::Entry& entry : folder.entries) {
+		entry_ref ref(folder.device, folder.node, entry.name.c_str());
+		SourceItem* sourceItem = new SourceItem(ref,
+			entry.isFolder ? SourceItemType::FolderItem : SourceItemType::FileItem);
+		sourceItem->SetProjectFolder(projectFolder);
+		ProjectItem* child = new ProjectItem(sourceItem);
+		child->SetExpanded(false);
+
+		auto opened = openedFiles.find(entry.name);
+		if (opened != openedFiles.end()) {
+			child->SetOpenedInEditor(true);
+			child->SetNeedsSave(opened->second);
+		}
+
+		fOutlineListView->AddUnder(child, item);
+		_AddPlaceholder(child);
+	}
+
+	// the entries are already sorted: this just keeps the list consistent
+	fOutlineListView->SortItemsUnder(item, true, ProjectOutlineListView::CompareProjectItems);
+}
+
+
+void
+ProjectBrowser::_FoldersScanned(BMessage* message)
+{
+	// empty folders don't need the placeholder
+	const char* path;
+	for (int32 i = 0; message->FindString("empty", i, &path) == B_OK; i++) {
+		ProjectItem* item = GetProjectItemByPath(path);
+		if (item != nullptr && !item->IsPopulated())
+			_PopulateItem(item);
+	}
 }
 
 
 void
 ProjectBrowser::InitRename(ProjectItem *item)
 {
+	if (item == nullptr)
+		return;
+
 	//ensure the item is visible!
 	if (fOutlineListView->Superitem(item)->IsExpanded() == false)
 		fOutlineListView->Expand(fOutlineListView->Superitem(item));
@@ -934,9 +1332,10 @@ ProjectBrowser::GetProjectList() const
 
 
 // ProjectOutlineListView
-ProjectOutlineListView::ProjectOutlineListView()
+ProjectOutlineListView::ProjectOutlineListView(ProjectBrowser* browser)
 	:
 	BOutlineListView("ProjectBrowserOutline", B_SINGLE_SELECTION_LIST),
+	fBrowser(browser),
 	fFileNewProjectMenuItem(nullptr)
 {
 	SetInvocationMessage(new BMessage(MSG_PROJECT_MENU_OPEN_FILE));
@@ -1001,6 +1400,24 @@ ProjectOutlineListView::DetachedFromWindow()
 }
 
 
+/* virtual */
+void
+ProjectOutlineListView::Draw(BRect updateRect)
+{
+	const bigtime_t start = system_time();
+	BOutlineListView::Draw(updateRect);
+
+	if (Logger::IsTraceEnabled()) {
+		int32 first = IndexOf(updateRect.LeftTop());
+		int32 last = IndexOf(updateRect.LeftBottom());
+		if (last < 0)
+			last = CountItems() - 1;
+		LogTrace("ProjectOutlineListView: %d rows drawn in %" B_PRId64 " us",
+			first < 0 ? 0 : last - first + 1, system_time() - start);
+	}
+}
+
+
 /* virtual */
 void
 ProjectOutlineListView::MessageReceived(BMessage* message)
@@ -1049,6 +1466,16 @@ ProjectOutlineListView::SelectionChanged()
 }
 
 
+/* virtual */
+void
+ProjectOutlineListView::ExpandOrCollapse(BListItem* superItem, bool expand)
+{
+	if (expand)
+		fBrowser->_PopulateItem(dynamic_cast<ProjectItem*>(superItem));
+	BOutlineListView::ExpandOrCollapse(superItem, expand);
+}
+
+
 ProjectItem*
 ProjectOutlineListView::ProjectItemAt(int32 index) const
 {
@@ -1063,7 +1490,11 @@ ProjectOutlineListView::GetSelectedProjectItem() const
 	if (selection < 0)
 		return nullptr;
 
-	return ProjectItemAt(selection);
+	// the placeholder stands for the folder content not read yet
+	ProjectItem* item = ProjectItemAt(selection);
+	if (item == nullptr || item->IsPlaceholder())
+		return nullptr;
+	return item;
 }
 
 
@@ -1109,6 +1540,8 @@ ProjectOutlineListView::_ShowProjectItemPopupMenu(BPoint where)
 {
 	// TODO: This duplicates some code in ProjectBrowser
 	ProjectItem* projectItem = GetSelectedProjectItem();
+	if (projectItem == nullptr)
+		return;
 	ProjectFolder *project;
 	if (projectItem->GetSourceItem()->Type() == SourceItemType::ProjectFolderItem) {
 		project = static_cast<ProjectFolder*>(projectItem->GetSourceItem());
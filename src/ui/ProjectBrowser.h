@@ -4,10 +4,14 @@
  */
 #pragma once
 
+#include <Message.h>
 #include <View.h>
 
 #include <ObjectList.h>
 
+#include <set>
+#include <vector>
+
 
 enum {
 	MSG_PROJECT_MENU_CLOSE				= 'pmcl',
@@ -23,10 +27,12 @@ enum {
 	MSG_BROWSER_SELECT_ITEM				= 'sele'
 };
 
+class BListItem;
 class ProjectOutlineListView;
 class ProjectFolder;
 class ProjectItem;
 class GenioWatchingFilter;
+class ProjectScanner;
 
 class ProjectBrowser : public BView {
 public:
@@ -40,7 +46,7 @@ public:
 	ProjectItem*	GetSelectedProjectItem() const;
 	const entry_ref* GetSelectedProjectFileRef() const;
 
-	ProjectItem*	GetItemByRef(ProjectFolder* project, const entry_ref& ref) const;
+	ProjectItem*	GetItemByRef(ProjectFolder* project, const entry_ref& ref);
 
 	ProjectItem*	GetProjectItemForProject(ProjectFolder*) const;
 
@@ -71,19 +77,37 @@ private:
 	ProjectItem*	_CreatePath(BPath pathToCreate);
 
 	ProjectItem*	_ProjectFolderScan(ProjectItem* item, const entry_ref* ref, ProjectFolder *projectFolder = NULL);
+	void			_AddPlaceholder(ProjectItem* item);
+	void			_PopulateItem(ProjectItem* item);
+	void			_FoldersScanned(BMessage* message);
 
 	void			_ShowProjectItemPopupMenu(BPoint where);
 
+	void			_InvalidateCaches(BMessage* message);
+	void			_QueueNodeUpdate(BMessage* message);
+	void			_FlushNodeUpdates();
 	void			_UpdateNode(BMessage *message);
+	void			_SortItemsUnder(BListItem* parent);
+	void			_UpdateIndex(BMessage *message);
 
 	status_t		_RenameCurrentSelectedFile(const BString& newName);
 
 	ProjectItem*	_CreateNewProjectItem(ProjectItem* parentItem, BPath path);
 
 private:
+	friend class ProjectOutlineListView;
+
 	ProjectOutlineListView*	fOutlineListView;
 	bool					fIsBuilding;
 	GenioWatchingFilter*	fGenioWatchingFilter;
+	ProjectScanner*			fScanner;
+
+	// path monitor events are applied in batches
+	std::vector<BMessage>	fPendingUpdates;
+	std::set<BListItem*>	fPendingSorts;
+	bool					fBatchingUpdates;
+	int64					fRawNodeEvents;
+	int64					fAppliedNodeEvents;
 
 	//TODO: remove this and use a std::vector<std::pair or similar.
 	BObjectList<ProjectFolder>	fProjectList;
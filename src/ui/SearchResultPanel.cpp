@@ -8,30 +8,44 @@
 
 #include <ColumnTypes.h>
 #include <Catalog.h>
+#include <Entry.h>
+#include <MessageRunner.h>
 #include <Window.h>
 #include <string>
 
 #include "ActionManager.h"
 #include "GenioWindowMessages.h"
+#include "Log.h"
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "SearchResultPanel"
 
 enum  {
-	SEARCHRESULT_CLICK = 'SrCl'
+	SEARCHRESULT_CLICK = 'SrCl',
+	SEARCHRESULT_FLUSH = 'SrFl'
 };
 
 enum {
 	kLocationColumn = 0,
 };
 
-class RangeRow : public BRow {
+// the results are added at most every kResultsInterval,
+// kResultsBatch lines per message
+static const bigtime_t kResultsInterval = 50000;
+static const size_t kResultsBatch = 500;
+
+
+class SearchResultPanel::RangeRow : public BRow {
 public:
-	RangeRow()
+	RangeRow(const std::string& path, int32 line)
+		:
+		fPath(path),
+		fLine(line)
 	{
 	};
 
-	BMessage fRange;
+	std::string	fPath;
+	int32		fLine;		// -1 for the file row
 };
 
 
@@ -70,15 +84,26 @@ public:
 SearchResultPanel::SearchResultPanel(BTabView* tabView)
 	:
 	BColumnListView(SearchResultPanelLabel, B_NAVIGABLE, B_FANCY_BORDER, true),
-	fGrepThread(nullptr),
+	fSearchThread(nullptr),
 	fTabView(tabView),
-	fCountResults(0)
+	fCountResults(0),
+	fMoreRow(nullptr),
+	fResultsScheduled(false),
+	fLastResults(0),
+	fSearchStart(0),
+	fResultBatches(0)
 {
 	AddColumn(new BFontStringColumn(B_TRANSLATE("Location"),
 								1000.0, 20.0, 2000.0, 0), kLocationColumn);
 }
 
 
+SearchResultPanel::~SearchResultPanel()
+{
+	delete fSearchThread;
+}
+
+
 void
 SearchResultPanel::SetTabLabel(BString label)
 {
@@ -95,25 +120,36 @@ SearchResultPanel::SetTabLabel(BString label)
 
 
 void
-SearchResultPanel::StartSearch(BString command, BString projectPath)
+SearchResultPanel::StartSearch(BString text, bool wholeWord, bool caseSensitive,
+	BString projectPath, BString excludeDirectories, ProjectIndex* index)
 {
-	if (fGrepThread)
-		return;
+	if (fSearchThread) {
+		// a search waiting for "more results" is abandoned
+		if (!fSearchThread->IsPaused())
+			return;
+		delete fSearchThread;
+		fSearchThread = nullptr;
+	}
 
 	fCountResults = 0;
+	fResultBatches = 0;
+	fSearchStart = system_time();
 	fProjectPath = projectPath;
 	if (!fProjectPath.EndsWith("/"))
 		fProjectPath.Append("/");
 	ClearSearch();
 
-	BMessage message;
-	message.AddString("cmd", command);
-
 	ActionManager::SetEnabled(MSG_FIND_IN_FILES, false);
 
 	_UpdateTabLabel("\xe2\x8c\x9b");//U+231x
-	fGrepThread = new GrepThread(&message, BMessenger(this));
-	fGrepThread->Start();
+	fSearchThread = new FindInFilesThread(BMessenger(this), text, wholeWord, caseSensitive,
+		projectPath, excludeDirectories, index);
+	if (fSearchThread->Start() != B_OK) {
+		delete fSearchThread;
+		fSearchThread = nullptr;
+		_UpdateTabLabel();
+		ActionManager::SetEnabled(MSG_FIND_IN_FILES, true);
+	}
 }
 
 
@@ -132,26 +168,43 @@ SearchResultPanel::MessageReceived(BMessage* msg)
 {
 	switch (msg->what) {
 		case MSG_REPORT_RESULT:
-			UpdateSearch(msg);
+			_ScheduleResults();
+			break;
+		case SEARCHRESULT_FLUSH:
+			fResultsScheduled = false;
+			_TakeResults(kResultsBatch);
 			break;
 		case SEARCHRESULT_CLICK:
 		{
 			RangeRow* range = dynamic_cast<RangeRow*>(CurrentSelection());
-			if (range && range->fRange.what == B_REFS_RECEIVED) {
-				Window()->PostMessage(&range->fRange);
+			if (range == nullptr)
+				break;
+			if (range == fMoreRow) {
+				_MoreResults();
+			} else if (range->fLine >= 0) {
+				entry_ref ref;
+				if (get_ref_for_path(range->fPath.c_str(), &ref) == B_OK) {
+					BMessage refs(B_REFS_RECEIVED);
+					refs.AddRef("refs", &ref);
+					refs.AddInt32("start:line", range->fLine);
+					Window()->PostMessage(&refs);
+				}
 			} else {
-				BRow* selected = CurrentSelection();
-				ExpandOrCollapse(selected, !selected->IsExpanded());
+				ExpandOrCollapse(range, !range->IsExpanded());
 			}
 			break;
 		}
-		case MSG_GREP_DONE:
+		case MSG_SEARCH_DONE:
 		{
-			if (fGrepThread) {
-				fGrepThread->InterruptExternal();
-				delete fGrepThread;
-				fGrepThread = nullptr;
+			if (fSearchThread) {
+				// everything still queued
+				_TakeResults(SIZE_MAX);
+				delete fSearchThread;
+				fSearchThread = nullptr;
 			}
+			_UpdateMoreRow();
+			LogInfo("Find in files: %d results shown in %d batches, %" B_PRId64 " ms",
+				fCountResults, fResultBatches, (system_time() - fSearchStart) / 1000);
 			_UpdateTabLabel(std::to_string(fCountResults).c_str());
 			ActionManager::SetEnabled(MSG_FIND_IN_FILES, true);
 			break;
@@ -167,46 +220,145 @@ void
 SearchResultPanel::ClearSearch()
 {
 	Clear();
+	fFileRows.clear();
+	fMoreRow = nullptr;
 	_UpdateTabLabel();
 }
 
 
 void
-SearchResultPanel::UpdateSearch(BMessage* msg)
+SearchResultPanel::_ScheduleResults()
 {
-	BString filename = msg->GetString("filename", "");
-	filename.RemoveFirst(fProjectPath);
-	if (filename.IsEmpty())
+	if (fResultsScheduled)
 		return;
-	RangeRow* parent = new RangeRow();
-	parent->fRange.MakeEmpty();
-
-	parent->SetField(new BBoldStringField(filename), kLocationColumn);
-	AddRow(parent);
-	int32 c = 0;
-	BMessage line;
-	BString text;
-	while (msg->FindMessage("line", c++, &line) == B_OK) {
-		if (line.FindString("text", &text) == B_OK) {
-			RangeRow* row = new RangeRow();
-			row->fRange = line;
-			row->SetField(new BStringField(text), kLocationColumn);
-			AddRow(row, parent);
-			fCountResults++;
-			if (c == 1)
-				ExpandOrCollapse(parent, true);
+
+	const bigtime_t delay = fLastResults + kResultsInterval - system_time();
+	if (delay <= 0) {
+		_TakeResults(kResultsBatch);
+		return;
+	}
+	BMessage flush(SEARCHRESULT_FLUSH);
+	if (BMessageRunner::StartSending(BMessenger(this), &flush, delay, 1) == B_OK)
+		fResultsScheduled = true;
+	else
+		_TakeResults(kResultsBatch);
+}
+
+
+void
+SearchResultPanel::_TakeResults(size_t maxLines)
+{
+	if (fSearchThread == nullptr)
+		return;
+
+	std::vector<FindInFilesThread::FileResult> results;
+	const bool more = fSearchThread->TakeResults(results, maxLines);
+	if (!results.empty()) {
+		if (fResultBatches == 0) {
+			LogInfo("Find in files: first results after %" B_PRId64 " ms",
+				(system_time() - fSearchStart) / 1000);
 		}
+		for (const FindInFilesThread::FileResult& result : results)
+			_AddResult(result);
+		fResultBatches++;
+		fLastResults = system_time();
+	}
+
+	if (more && !fResultsScheduled) {
+		// the next batch after the pending messages (drawing, input...)
+		BMessenger(this).SendMessage(SEARCHRESULT_FLUSH);
+		fResultsScheduled = true;
+	}
+	_UpdateMoreRow();
+}
+
+
+void
+SearchResultPanel::_AddResult(const FindInFilesThread::FileResult& result)
+{
+	// a file with many matches is reported in parts
+	RangeRow* parent;
+	bool added = false;
+	auto found = fFileRows.find(result.path);
+	if (found != fFileRows.end()) {
+		parent = found->second;
+	} else {
+		BString filename(result.path.c_str());
+		filename.RemoveFirst(fProjectPath);
+		parent = new RangeRow(result.path, -1);
+		parent->SetField(new BBoldStringField(filename), kLocationColumn);
+		AddRow(parent);
+		fFileRows[result.path] = parent;
+		added = true;
+	}
+
+	for (const FindInFilesThread::Line& line : result.lines) {
+		RangeRow* row = new RangeRow(result.path, line.number);
+		BString label;
+		label << line.number << ": " << line.text.c_str();
+		row->SetField(new BStringField(label), kLocationColumn);
+		AddRow(row, parent);
+		fCountResults++;
+	}
+	if (added)
+		ExpandOrCollapse(parent, true);
+}
+
+
+void
+SearchResultPanel::_UpdateMoreRow()
+{
+	const bool paused = fSearchThread != nullptr && !fResultsScheduled
+		&& fSearchThread->IsPaused();
+	if (paused == (fMoreRow != nullptr))
+		return;
+
+	if (paused) {
+		fMoreRow = new RangeRow("", -1);
+		fMoreRow->SetField(new BBoldStringField(
+			B_TRANSLATE("Show more results" B_UTF8_ELLIPSIS)), kLocationColumn);
+		AddRow(fMoreRow);
+		BString count;
+		count << fCountResults << "+";
+		_UpdateTabLabel(count.String());
+		// a new search can replace this one
+		ActionManager::SetEnabled(MSG_FIND_IN_FILES, true);
+	} else {
+		RemoveRow(fMoreRow);
+		delete fMoreRow;
+		fMoreRow = nullptr;
 	}
 }
 
 
+void
+SearchResultPanel::_MoreResults()
+{
+	if (fSearchThread == nullptr)
+		return;
+
+	RemoveRow(fMoreRow);
+	delete fMoreRow;
+	fMoreRow = nullptr;
+
+	_UpdateTabLabel("\xe2\x8c\x9b");//U+231x
+	ActionManager::SetEnabled(MSG_FIND_IN_FILES, false);
+	fSearchThread->MoreResults();
+}
+
+
 void
 SearchResultPanel::KeyDown(const char* bytes, int32 numBytes)
 {
 	if (numBytes > 0 && bytes[0] == B_DELETE) {
 		RangeRow* range = dynamic_cast<RangeRow*>(CurrentSelection());
-		if (range != nullptr)
+		if (range != nullptr) {
+			if (range == fMoreRow)
+				fMoreRow = nullptr;
+			else if (range->fLine < 0)
+				fFileRows.erase(range->fPath);
 			RemoveRow(range);
+		}
 	}
 	BColumnListView::KeyDown(bytes, numBytes);
 }
@@ -8,7 +8,11 @@
 #include <ColumnListView.h>
 #include <SupportDefs.h>
 #include <TabView.h>
-#include "GrepThread.h"
+
+#include <map>
+#include <string>
+
+#include "FindInFilesThread.h"
 
 // For now this is specific to manage only the FindInFiles results
 // Can be extended to handle more generic 'search' results (find references)
@@ -16,8 +20,11 @@
 class SearchResultPanel : public BColumnListView {
 public:
 		SearchResultPanel(BTabView*);
+		~SearchResultPanel();
 
-		void StartSearch(BString command, BString projectPath);
+		void StartSearch(BString text, bool wholeWord, bool caseSensitive,
+					BString projectPath, BString excludeDirectories,
+					ProjectIndex* index = nullptr);
 
 		virtual void	MessageReceived(BMessage* msg);
 		virtual void	AttachedToWindow();
@@ -26,13 +33,26 @@ public:
 		void	SetTabLabel(BString label);
 
 private:
+		class RangeRow;
+
 		void	_UpdateTabLabel(const char* txt = nullptr);
 		void	ClearSearch();
-		void 	UpdateSearch(BMessage* msg);
-		GrepThread*	fGrepThread;
+		void	_ScheduleResults();
+		void	_TakeResults(size_t maxLines);
+		void	_AddResult(const FindInFilesThread::FileResult& result);
+		void	_UpdateMoreRow();
+		void	_MoreResults();
+		FindInFilesThread*	fSearchThread;
 		BString 	fProjectPath;
 		BTabView*	fTabView;
 		int32		fCountResults;
+
+		std::map<std::string, RangeRow*>	fFileRows;
+		RangeRow*	fMoreRow;
+		bool		fResultsScheduled;
+		bigtime_t	fLastResults;
+		bigtime_t	fSearchStart;
+		int32		fResultBatches;
 };
 
 
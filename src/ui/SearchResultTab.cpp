@@ -220,33 +220,10 @@ SearchResultTab::_StartSearch(BString text, bool wholeWord, bool caseSensitive,
 	if (text.IsEmpty())
 		return;
 
-	BString extraParameters;
-	if (wholeWord)
-		extraParameters += "w";
-
-	if (!caseSensitive)
-		extraParameters += "i";
-
-	text.CharacterEscape("\\\n\"", '\\');
-
-	BString grepCommand("grep");
+	LogInfo("Find in files: [%s] in [%s]", text.String(), project->Path().String());
 	BString excludeDir(gCFG["find_exclude_directory"]);
-	if (!excludeDir.IsEmpty()) {
-		if (excludeDir.FindFirst(",") >= 0)
-			grepCommand << " --exclude-dir={" << excludeDir << "}";
-		else
-			grepCommand << " --exclude-dir=" << excludeDir << "";
-	}
-
-	grepCommand += " -IFHrn";
-	grepCommand += extraParameters;
-	grepCommand += " -- ";
-	grepCommand += EscapeQuotesWrap(text);
-	grepCommand += " ";
-	grepCommand += EscapeQuotesWrap(project->Path());
-
-	LogInfo("Find in file, executing: [%s]", grepCommand.String());
-	fSearchResultPanel->StartSearch(grepCommand, project->Path());
+	fSearchResultPanel->StartSearch(text, wholeWord, caseSensitive, project->Path(), excludeDir,
+		project->Index());
 }
 
 